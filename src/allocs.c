@@ -0,0 +1,118 @@
+/*! \file allocs.c
+ *  \brief Counting of heap allocations made by the whole process.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "allocs.h"
+
+#if ALLOCS_TRACKED
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stddef.h>
+
+// glibc's own entry points, which stay reachable when malloc and friends get interposed
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void* __libc_memalign(size_t alignment, size_t size);
+extern void* __libc_valloc(size_t size);
+extern void* __libc_pvalloc(size_t size);
+
+static atomic_uint_fast64_t allocations;
+
+void* malloc(size_t size) {
+	atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+	return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+	atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+	return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+	atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+	return __libc_realloc(ptr, size);
+}
+
+void* reallocarray(void* ptr, size_t count, size_t size) {
+	// glibc's own one calls its realloc directly, which would go uncounted
+	size_t bytes;
+	if (__builtin_mul_overflow(count, size, &bytes)) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	return realloc(ptr, bytes);
+}
+
+// The aligned variants have no __libc_ entry points of their own (or not in every glibc version),
+// so they all go through __libc_memalign, which is what glibc implements them with anyway.
+
+void* memalign(size_t alignment, size_t size) {
+	atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+	return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+	atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+	return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) {
+	if ((alignment % sizeof(void*)) || (alignment & (alignment - 1))) {
+		return EINVAL;
+	}
+	atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+	void* result = __libc_memalign(alignment, size);
+	if (!result) {
+		return ENOMEM;
+	}
+	*ptr = result;
+	return 0;
+}
+
+void* valloc(size_t size) {
+	atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+	return __libc_valloc(size);
+}
+
+void* pvalloc(size_t size) {
+	atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+	return __libc_pvalloc(size);
+}
+
+bool IsAllocationTrackingEnabled(void) {
+	return true;
+}
+
+uint64_t GetAllocationCount(void) {
+	return atomic_load_explicit(&allocations, memory_order_relaxed);
+}
+
+#else
+
+bool IsAllocationTrackingEnabled(void) {
+	return false;
+}
+
+uint64_t GetAllocationCount(void) {
+	return 0;
+}
+
+#endif
@@ -0,0 +1,38 @@
+/*! \file allocs.h
+ *  \brief Counting of heap allocations made by the whole process.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ALLOCS_H
+#define ALLOCS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Allocations are only counted when built with BOILEDCORN_TRACK_ALLOCATIONS against glibc,
+// which lets malloc and all of its variants be replaced for every library in the process.
+#if defined(BOILEDCORN_TRACK_ALLOCATIONS) && defined(__GLIBC__)
+#define ALLOCS_TRACKED 1
+#else
+#define ALLOCS_TRACKED 0
+#endif
+
+bool IsAllocationTrackingEnabled(void);
+uint64_t GetAllocationCount(void); /*!< Number of allocations made so far, always 0 when not tracked. */
+
+#endif
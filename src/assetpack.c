@@ -0,0 +1,72 @@
+/*! \file assetpack.c
+ *  \brief Archive of pre-decoded assets.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "assetpack.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct AssetPack* OpenAssetPack(const char* path) {
+	struct AssetPack* pack = calloc(1, sizeof(struct AssetPack));
+	if (!MapFile(&pack->file, path)) {
+		free(pack);
+		return NULL;
+	}
+
+	const struct AssetPackHeader* header = pack->file.data;
+	size_t index_end = sizeof(struct AssetPackHeader);
+	if (pack->file.size >= sizeof(struct AssetPackHeader)) {
+		index_end += (size_t)header->count * sizeof(struct AssetPackEntry);
+	}
+	if ((pack->file.size < sizeof(struct AssetPackHeader)) || (memcmp(header->magic, ASSETPACK_MAGIC, 4) != 0) ||
+		(header->version != ASSETPACK_VERSION) || (index_end > pack->file.size)) {
+		CloseAssetPack(pack);
+		return NULL;
+	}
+	pack->entries = (const struct AssetPackEntry*)(header + 1);
+	pack->count = header->count;
+
+	for (uint32_t i = 0; i < pack->count; i++) {
+		if ((pack->entries[i].offset > pack->file.size) || (pack->entries[i].size > pack->file.size - pack->entries[i].offset)) {
+			CloseAssetPack(pack);
+			return NULL;
+		}
+	}
+	return pack;
+}
+
+void CloseAssetPack(struct AssetPack* pack) {
+	UnmapFile(&pack->file);
+	free(pack);
+}
+
+static int CompareEntry(const void* key, const void* entry) {
+	return strncmp(key, ((const struct AssetPackEntry*)entry)->name, ASSETPACK_NAME_LENGTH);
+}
+
+const struct AssetPackEntry* FindPackedAsset(const struct AssetPack* pack, const char* name) {
+	if (!pack) {
+		return NULL;
+	}
+	return bsearch(name, pack->entries, pack->count, sizeof(struct AssetPackEntry), CompareEntry);
+}
+
+const void* GetPackedAssetData(const struct AssetPack* pack, const struct AssetPackEntry* entry) {
+	return (const char*)pack->file.data + entry->offset;
+}
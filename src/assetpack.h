@@ -0,0 +1,67 @@
+/*! \file assetpack.h
+ *  \brief Archive of pre-decoded assets.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ASSETPACK_H
+#define ASSETPACK_H
+
+#include "mapfile.h"
+#include <stdint.h>
+
+// An asset pack is a header, followed by an index of entries sorted by name and then by their data.
+// Everything is stored in host byte order, as packs are generated for the platform they're built for.
+#define ASSETPACK_FILENAME "assets.pak"
+#define ASSETPACK_MAGIC "BCPK"
+#define ASSETPACK_VERSION 1
+#define ASSETPACK_NAME_LENGTH 48
+#define ASSETPACK_ALIGNMENT 16
+
+enum AssetPackType {
+	ASSETPACK_FILE, /*!< Original file contents, e.g. for streams and fonts. */
+	ASSETPACK_BITMAP, /*!< ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE pixels; params: width, height. */
+	ASSETPACK_SAMPLE, /*!< Raw PCM; params: sample count, frequency, ALLEGRO_AUDIO_DEPTH, ALLEGRO_CHANNEL_CONF. */
+};
+
+struct AssetPackHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t count;
+	uint32_t reserved;
+};
+
+struct AssetPackEntry {
+	char name[ASSETPACK_NAME_LENGTH];
+	uint32_t type;
+	uint32_t size;
+	uint64_t offset; /*!< From the start of the pack, aligned to ASSETPACK_ALIGNMENT. */
+	uint32_t params[4];
+};
+
+struct AssetPack {
+	struct MappedFile file;
+	const struct AssetPackEntry* entries;
+	uint32_t count;
+};
+
+struct AssetPack* OpenAssetPack(const char* path);
+void CloseAssetPack(struct AssetPack* pack);
+const struct AssetPackEntry* FindPackedAsset(const struct AssetPack* pack, const char* name);
+const void* GetPackedAssetData(const struct AssetPack* pack, const struct AssetPackEntry* entry);
+
+#endif
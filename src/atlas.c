@@ -0,0 +1,106 @@
+/*! \file atlas.c
+ *  \brief Packing of many small bitmaps into a single texture.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "atlas.h"
+
+#define ATLAS_PADDING 1
+
+ALLEGRO_BITMAP* LoadMemoryBitmap(const char* path) {
+	ALLEGRO_STATE state;
+	al_store_state(&state, ALLEGRO_STATE_NEW_BITMAP_PARAMETERS);
+	al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+	al_set_new_bitmap_format(ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE);
+	ALLEGRO_BITMAP* bitmap = al_load_bitmap(path);
+	al_restore_state(&state);
+	return bitmap;
+}
+
+void AtlasAdd(struct Atlas* atlas, ALLEGRO_BITMAP* source, ALLEGRO_BITMAP** out) {
+	*out = NULL;
+	if (!source || atlas->count == ATLAS_MAX_ENTRIES) {
+		*out = source;
+		return;
+	}
+	atlas->entries[atlas->count].source = source;
+	atlas->entries[atlas->count].out = out;
+	atlas->count++;
+}
+
+static int Pack(struct Atlas* atlas) {
+	// Simple shelf packing, tallest bitmaps first.
+	int order[ATLAS_MAX_ENTRIES];
+	for (int i = 0; i < atlas->count; i++) {
+		int j = i;
+		while (j > 0 && al_get_bitmap_height(atlas->entries[order[j - 1]].source) < al_get_bitmap_height(atlas->entries[i].source)) {
+			order[j] = order[j - 1];
+			j--;
+		}
+		order[j] = i;
+	}
+
+	int x = 0, y = 0, shelf = 0;
+	for (int i = 0; i < atlas->count; i++) {
+		ALLEGRO_BITMAP* source = atlas->entries[order[i]].source;
+		int w = al_get_bitmap_width(source), h = al_get_bitmap_height(source);
+		if (x + w > ATLAS_WIDTH) {
+			x = 0;
+			y += shelf + ATLAS_PADDING;
+			shelf = 0;
+		}
+		atlas->entries[order[i]].x = x;
+		atlas->entries[order[i]].y = y;
+		x += w + ATLAS_PADDING;
+		if (h > shelf) {
+			shelf = h;
+		}
+	}
+	return y + shelf;
+}
+
+ALLEGRO_BITMAP* AtlasBuild(struct Atlas* atlas) {
+	if (!atlas->count) {
+		return NULL;
+	}
+	int height = Pack(atlas);
+	ALLEGRO_BITMAP* bitmap = al_create_bitmap(ATLAS_WIDTH, height);
+
+	ALLEGRO_LOCKED_REGION* dst = al_lock_bitmap(bitmap, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_WRITEONLY);
+	for (int y = 0; y < height; y++) {
+		memset((char*)dst->data + y * dst->pitch, 0, ATLAS_WIDTH * 4);
+	}
+	for (int i = 0; i < atlas->count; i++) {
+		ALLEGRO_BITMAP* source = atlas->entries[i].source;
+		int w = al_get_bitmap_width(source), h = al_get_bitmap_height(source);
+		ALLEGRO_LOCKED_REGION* src = al_lock_bitmap(source, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_READONLY);
+		for (int y = 0; y < h; y++) {
+			memcpy((char*)dst->data + (atlas->entries[i].y + y) * dst->pitch + atlas->entries[i].x * 4, (char*)src->data + y * src->pitch, w * 4);
+		}
+		al_unlock_bitmap(source);
+	}
+	al_unlock_bitmap(bitmap);
+
+	for (int i = 0; i < atlas->count; i++) {
+		ALLEGRO_BITMAP* source = atlas->entries[i].source;
+		*atlas->entries[i].out = al_create_sub_bitmap(bitmap, atlas->entries[i].x, atlas->entries[i].y, al_get_bitmap_width(source), al_get_bitmap_height(source));
+		al_destroy_bitmap(source);
+	}
+	atlas->count = 0;
+	return bitmap;
+}
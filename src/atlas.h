@@ -0,0 +1,43 @@
+/*! \file atlas.h
+ *  \brief Packing of many small bitmaps into a single texture.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include "common.h"
+
+#define ATLAS_WIDTH 256
+#define ATLAS_MAX_ENTRIES 32
+
+/*! \brief Collects bitmaps to be packed together with AtlasBuild. */
+struct Atlas {
+	int count;
+	struct {
+		ALLEGRO_BITMAP* source;
+		ALLEGRO_BITMAP** out;
+		int x, y;
+	} entries[ATLAS_MAX_ENTRIES];
+};
+
+ALLEGRO_BITMAP* LoadMemoryBitmap(const char* path);
+void AtlasAdd(struct Atlas* atlas, ALLEGRO_BITMAP* source, ALLEGRO_BITMAP** out);
+ALLEGRO_BITMAP* AtlasBuild(struct Atlas* atlas);
+
+#endif
@@ -0,0 +1,478 @@
+/*! \file beachsim.c
+ *  \brief Display-less simulation core of the beach gamestate.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "beachsim.h"
+#include <stdlib.h>
+#include <string.h>
+
+const struct BeachParams BeachDefaultParams = {
+	.max_power = 32,
+	.throw_speed = 2,
+	.scroll_ticks = 8,
+	.satisfied_chance = 10,
+	.throws = 32,
+	.spawn_x = 45,
+	.spawn_width = 100,
+};
+
+void BeachRandomSeed(struct BeachRandom* random, uint64_t seed) {
+	// splitmix64, so that similar seeds don't produce similar sequences
+	uint64_t z = seed + 0x9E3779B97F4A7C15ull;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	random->state = (z ^ (z >> 31)) | 1;
+}
+
+int BeachRandomNext(struct BeachRandom* random, int max) {
+	// xorshift64*
+	random->state ^= random->state >> 12;
+	random->state ^= random->state << 25;
+	random->state ^= random->state >> 27;
+	return (int)(((random->state * 0x2545F4914F6CDD1Dull) >> 33) % (uint64_t)max);
+}
+
+void BeachAutoplayerInit(struct BeachAutoplayer* player, uint64_t seed, int max_hold) {
+	BeachRandomSeed(&player->random, seed);
+	player->hold = 0;
+	player->max_hold = max_hold;
+	player->once = false;
+}
+
+unsigned int BeachAutoplay(struct BeachAutoplayer* player, const struct BeachSim* sim) {
+	if (!sim->started) {
+		return (player->once && sim->started_once) ? 0 : (BEACH_INPUT_PRESS | BEACH_INPUT_RELEASE);
+	}
+	if (sim->preparing) {
+		return (--player->hold <= 0) ? BEACH_INPUT_RELEASE : 0;
+	}
+	if (!sim->throwing || sim->rapid_fire) {
+		player->hold = 1 + BeachRandomNext(&player->random, player->max_hold);
+		return BEACH_INPUT_PRESS;
+	}
+	return 0;
+}
+
+// asin(k / 16) for k from 1 to 15 in sea phase units, rounded up, followed by the smallest phase for which
+// the sine rounds to exactly 1 in double precision. Generated with 80 digits of precision by tools/seatable.py.
+static const uint64_t sea_thresholds[] = {
+	0x01002ABDE9536195ull, 0x020157C18253C3C2ull, 0x0304929DA1CF1F76ull, 0x040AFA7382E1F348ull,
+	0x0515CE4EE438AA9Cull, 0x06267D3B7258B4C2ull, 0x073EBC9D183FA7B4ull, 0x0860A91C16B9B2C3ull,
+	0x098EFA07DE98E682ull, 0x0ACD56B8E768077Aull, 0x0C20EF5A88A5D9D7ull, 0x0D91A98AE3406E05ull,
+	0x0F2CC2AB3DB32E87ull, 0x110C066D3E6931B8ull, 0x13722D2FEB24C7DAull, 0x1921FB5170194B77ull};
+
+int BeachSeaWave(uint64_t phase) {
+	// (int)(fabs(sin(phase)) * 16), without touching floating point
+	if (phase > BEACH_SEA_PHASE_PI / 2) {
+		phase = BEACH_SEA_PHASE_PI - phase;
+	}
+	int height = 0;
+	while ((height < 16) && (phase >= sea_thresholds[height])) {
+		height++;
+	}
+	return height;
+}
+
+static int GridCell(const struct BeachPeople* people, int x, int y) {
+	int row = (y - people->shift) % (BEACH_GRID_ROWS * BEACH_GRID_CELL);
+	if (row < 0) {
+		row += BEACH_GRID_ROWS * BEACH_GRID_CELL;
+	}
+	int column = x / BEACH_GRID_CELL;
+	if (column < 0) {
+		column = 0;
+	}
+	if (column >= BEACH_GRID_COLUMNS) {
+		column = BEACH_GRID_COLUMNS - 1;
+	}
+	return row / BEACH_GRID_CELL * BEACH_GRID_COLUMNS + column;
+}
+
+static void GridInsert(struct BeachPeople* people, int i) {
+	int cell = GridCell(people, people->x[i], people->y[i]);
+	people->cell[i] = cell;
+	people->prev[i] = -1;
+	people->next[i] = people->grid[cell];
+	if (people->grid[cell] != -1) {
+		people->prev[people->grid[cell]] = i;
+	}
+	people->grid[cell] = i;
+}
+
+static void GridRemove(struct BeachPeople* people, int i) {
+	if (people->prev[i] != -1) {
+		people->next[people->prev[i]] = people->next[i];
+	} else {
+		people->grid[people->cell[i]] = people->next[i];
+	}
+	if (people->next[i] != -1) {
+		people->prev[people->next[i]] = people->prev[i];
+	}
+}
+
+static bool OnTowel(const struct BeachPeople* people, int i, int x, int y) {
+	int x1 = people->x[i], y1 = people->y[i];
+	int x2 = x1 + BEACH_TOWEL_WIDTH, y2 = y1 + BEACH_TOWEL_HEIGHT;
+	return (x >= x1) && (x <= x2) && (y >= y1) && (y <= y2);
+}
+
+static void PlacePeople(struct BeachSim* sim) {
+	struct BeachPeople* people = &sim->people;
+	int last = people->count - 1;
+	for (int i = 0; i < people->count; i++) {
+		// spread over the same distance as the default six people are, 22 pixels apart
+		people->satisfied[i] = true;
+		people->x[i] = BeachRandomNext(&sim->random, sim->params.spawn_width) + sim->params.spawn_x;
+		people->y[i] = 90 - (int)(22LL * BEACH_PEOPLE * i / people->count) + BeachRandomNext(&sim->random, 5);
+		people->boy[i] = BeachRandomNext(&sim->random, 2);
+		people->towel[i] = BeachRandomNext(&sim->random, 3);
+	}
+	people->x[0] = 65;
+	people->x[last] = 110;
+	if (last > 0) {
+		people->satisfied[last - 1] = false;
+	}
+	people->satisfied[last] = false;
+
+	for (int i = 0; i < BEACH_GRID_ROWS * BEACH_GRID_COLUMNS; i++) {
+		people->grid[i] = -1;
+	}
+	for (int i = 0; i < people->count; i++) {
+		GridInsert(people, i);
+	}
+}
+
+static void RespawnPerson(struct BeachSim* sim, int i) {
+	struct BeachPeople* people = &sim->people;
+	GridRemove(people, i);
+	people->y[i] = -20 + BeachRandomNext(&sim->random, 5);
+	people->boy[i] = BeachRandomNext(&sim->random, 2);
+	people->towel[i] = BeachRandomNext(&sim->random, 3);
+	people->satisfied[i] = false;
+	if ((sim->params.satisfied_chance > 0) && (BeachRandomNext(&sim->random, sim->params.satisfied_chance) == 0)) {
+		people->satisfied[i] = true;
+	}
+	if ((i != 0) && (i != people->count - 1)) {
+		people->x[i] = BeachRandomNext(&sim->random, sim->params.spawn_width) + sim->params.spawn_x;
+	}
+	GridInsert(people, i);
+}
+
+static void Shout(struct BeachSim* sim) {
+	sim->corn = BeachRandomNext(&sim->random, 3);
+	sim->events |= BEACH_EVENT_CORN;
+}
+
+void BeachSimInit(struct BeachSim* sim, uint64_t seed, int people) {
+	BeachSimInitWithParams(sim, seed, people, &BeachDefaultParams);
+}
+
+void BeachSimInitWithParams(struct BeachSim* sim, uint64_t seed, int people, const struct BeachParams* params) {
+	memset(sim, 0, sizeof(struct BeachSim));
+	sim->params = *params;
+	if (people < 1) {
+		people = 1;
+	}
+	if (people > BEACH_MAX_PEOPLE) {
+		people = BEACH_MAX_PEOPLE;
+	}
+	sim->people.count = people;
+	sim->people.x = calloc(people, sizeof(int));
+	sim->people.y = calloc(people, sizeof(int));
+	sim->people.satisfied = calloc(people, sizeof(uint8_t));
+	sim->people.boy = calloc(people, sizeof(uint8_t));
+	sim->people.towel = calloc(people, sizeof(uint8_t));
+	sim->people.cell = calloc(people, sizeof(int));
+	sim->people.next = calloc(people, sizeof(int));
+	sim->people.prev = calloc(people, sizeof(int));
+	BeachRandomSeed(&sim->random, seed);
+	PlacePeople(sim);
+	sim->score = -1;
+	Shout(sim);
+}
+
+void BeachSimDestroy(struct BeachSim* sim) {
+	free(sim->people.x);
+	free(sim->people.y);
+	free(sim->people.satisfied);
+	free(sim->people.boy);
+	free(sim->people.towel);
+	free(sim->people.cell);
+	free(sim->people.next);
+	free(sim->people.prev);
+	memset(&sim->people, 0, sizeof(struct BeachPeople));
+}
+
+static void Land(struct BeachSim* sim, struct BeachCorn* corn) {
+	corn->active = false;
+	sim->throwing--;
+	sim->left--;
+
+	int x = (int)corn->x;
+	int y = corn->y + 2;
+	int person = BeachSimFindTowel(sim, x, y);
+	bool fine;
+	if (person != -1) {
+		sim->people.satisfied[person] = true;
+		fine = true;
+	} else {
+		// landing on a satisfied person's towel only counts for the last one
+		fine = OnTowel(&sim->people, sim->people.count - 1, x, y);
+	}
+	if (!fine) {
+		sim->lostx[sim->lost] = (int)corn->x;
+		sim->losty[sim->lost] = corn->y - 3;
+		sim->lost++;
+		sim->score--;
+		sim->events |= BEACH_EVENT_MISS;
+	} else {
+		sim->score++;
+		sim->events |= BEACH_EVENT_HIT;
+	}
+
+	if (sim->left == 0) {
+		sim->started = false;
+		sim->events |= BEACH_EVENT_END;
+	}
+}
+
+void BeachSimTick(struct BeachSim* sim) {
+	sim->frames++;
+	sim->counter++;
+	if (sim->preparing) {
+		sim->power++;
+		if (sim->power > sim->params.max_power) {
+			sim->power = sim->params.max_power;
+		}
+	}
+	sim->lost = 0;
+	for (int i = 0; i < BEACH_MAX_CORNS; i++) {
+		struct BeachCorn* corn = &sim->corns[i];
+		if (corn->active) {
+			corn->x += sim->params.throw_speed;
+			if (corn->x >= corn->target) {
+				Land(sim, corn);
+			}
+		}
+	}
+
+	if ((sim->started) && (sim->counter >= sim->params.scroll_ticks)) {
+		sim->counter = 0;
+		sim->seay++;
+		sim->events |= BEACH_EVENT_STEP;
+
+		for (int i = 0; i < BEACH_MAX_CORNS; i++) {
+			sim->corns[i].y += sim->corns[i].active;
+		}
+
+		// Scroll everyone first, then respawn those who went off screen in order, which draws
+		// random numbers in the same sequence as doing both at once would.
+		int* y = sim->people.y;
+		int count = sim->people.count;
+		for (int i = 0; i < count; i++) {
+			y[i]++;
+		}
+		sim->people.shift = (sim->people.shift + 1) % (BEACH_GRID_ROWS * BEACH_GRID_CELL);
+		for (int i = 0; i < count; i++) {
+			if (y[i] > 95) {
+				RespawnPerson(sim, i);
+			}
+		}
+	}
+	if (sim->seay == 120) {
+		sim->seay = 0;
+		Shout(sim);
+	}
+	sim->prevsandx = sim->sandx;
+	sim->prevseax = sim->seax;
+	sim->seaphase += BEACH_SEA_PHASE_STEP;
+	if (sim->seaphase >= BEACH_SEA_PHASE_PI) {
+		sim->seaphase -= BEACH_SEA_PHASE_PI;
+	}
+	sim->seax = BeachSeaWave(sim->seaphase);
+	if (sim->seax == 15) {
+		sim->maxsea = BeachRandomNext(&sim->random, 7);
+	}
+	if (sim->seax < sim->maxsea) {
+		sim->seax = sim->maxsea;
+	}
+	if (sim->seax == sim->maxsea) {
+		sim->sandx = sim->maxsea;
+		sim->sandleft = 255;
+	}
+	sim->sandleft -= 2;
+	if (sim->sandleft < 0) {
+		sim->sandleft = 0;
+	}
+}
+
+void BeachSimPress(struct BeachSim* sim) {
+	if (!sim->started) {
+		sim->started = true;
+		if (sim->started_once) {
+			PlacePeople(sim);
+		}
+		sim->started_once = true;
+		sim->score = 0;
+		sim->left = sim->params.throws;
+		sim->events |= BEACH_EVENT_START;
+		Shout(sim);
+	} else {
+		if (!sim->throwing || (sim->rapid_fire && !sim->preparing)) {
+			sim->preparing = true;
+			sim->power = 0;
+		}
+	}
+}
+
+void BeachSimRelease(struct BeachSim* sim) {
+	if (!sim->preparing) {
+		return;
+	}
+	sim->preparing = false;
+	if (sim->throwing >= sim->left) {
+		return; // every corn that's left is already flying
+	}
+	for (int i = 0; i < BEACH_MAX_CORNS; i++) {
+		struct BeachCorn* corn = &sim->corns[i];
+		if (!corn->active) {
+			corn->active = true;
+			corn->x = BEACH_CORN_X;
+			corn->y = BEACH_CORN_Y;
+			corn->target = (int)(BEACH_GUY_X / (double)BEACH_WIDTH + 5 * sim->power);
+			sim->throwing++;
+			sim->events |= BEACH_EVENT_THROW;
+			return;
+		}
+	}
+}
+
+static uint64_t HashInt(uint64_t hash, int64_t value) {
+	// FNV-1a, fed byte by byte so that the result doesn't depend on struct padding or endianness
+	for (int i = 0; i < 8; i++) {
+		hash ^= (uint64_t)(value >> (i * 8)) & 0xFF;
+		hash *= 0x100000001B3ull;
+	}
+	return hash;
+}
+
+uint64_t BeachSimHash(const struct BeachSim* sim) {
+	uint64_t hash = 0xCBF29CE484222325ull;
+	hash = HashInt(hash, (int64_t)sim->random.state);
+	hash = HashInt(hash, sim->started);
+	hash = HashInt(hash, sim->started_once);
+	hash = HashInt(hash, sim->frames);
+	hash = HashInt(hash, sim->counter);
+	for (int i = 0; i < sim->people.count; i++) {
+		hash = HashInt(hash, sim->people.x[i]);
+		hash = HashInt(hash, sim->people.y[i]);
+		hash = HashInt(hash, sim->people.satisfied[i]);
+		hash = HashInt(hash, sim->people.boy[i]);
+		hash = HashInt(hash, sim->people.towel[i]);
+	}
+	hash = HashInt(hash, sim->power);
+	hash = HashInt(hash, sim->left);
+	hash = HashInt(hash, sim->preparing);
+	hash = HashInt(hash, sim->throwing);
+	hash = HashInt(hash, (int64_t)(sim->corns[0].x * 256));
+	hash = HashInt(hash, sim->corns[0].y);
+	hash = HashInt(hash, sim->corns[0].target);
+	hash = HashInt(hash, sim->score);
+	hash = HashInt(hash, sim->sandx);
+	hash = HashInt(hash, sim->seax);
+	hash = HashInt(hash, sim->seay);
+	hash = HashInt(hash, sim->maxsea);
+	hash = HashInt(hash, sim->sandleft);
+	if (sim->rapid_fire) {
+		// the other corns are left out otherwise, so that hashes match those from before they were added
+		for (int i = 1; i < BEACH_MAX_CORNS; i++) {
+			hash = HashInt(hash, sim->corns[i].active);
+			hash = HashInt(hash, (int64_t)(sim->corns[i].x * 256));
+			hash = HashInt(hash, sim->corns[i].y);
+			hash = HashInt(hash, sim->corns[i].target);
+		}
+	}
+	return hash;
+}
+
+void BeachSnapshotView(struct BeachSnapshot* snapshot, const struct BeachSim* sim) {
+	// The people are not copied; the snapshot points at the simulation's arrays until the next tick.
+	snapshot->started = sim->started;
+	snapshot->started_once = sim->started_once;
+	snapshot->preparing = sim->preparing;
+	snapshot->throwing = sim->throwing;
+	snapshot->power = sim->power;
+	snapshot->left = sim->left;
+	snapshot->score = sim->score;
+	snapshot->counter = sim->counter;
+	snapshot->scroll_ticks = sim->params.scroll_ticks;
+	snapshot->throw_speed = sim->params.throw_speed;
+	snapshot->sandx = sim->sandx;
+	snapshot->prevsandx = sim->prevsandx;
+	snapshot->seax = sim->seax;
+	snapshot->prevseax = sim->prevseax;
+	snapshot->seay = sim->seay;
+	snapshot->sandleft = sim->sandleft;
+	memcpy(snapshot->corns, sim->corns, sizeof(snapshot->corns));
+	snapshot->people = sim->people.count;
+	snapshot->x = sim->people.x;
+	snapshot->y = sim->people.y;
+	snapshot->satisfied = sim->people.satisfied;
+	snapshot->boy = sim->people.boy;
+	snapshot->towel = sim->people.towel;
+}
+
+int BeachSimFindTowel(const struct BeachSim* sim, int x, int y) {
+	// Returns the first unsatisfied person (by index) whose towel contains the point, or -1.
+	const struct BeachPeople* people = &sim->people;
+	int rows[2], nrows = 0;
+	int result = -1;
+
+	// Towels containing the point have their corner within a towel's size up and left from it,
+	// which spans at most two rows of cells.
+	int first = GridCell(people, x, y - BEACH_TOWEL_HEIGHT) / BEACH_GRID_COLUMNS;
+	int last = GridCell(people, x, y) / BEACH_GRID_COLUMNS;
+	rows[nrows++] = first;
+	if (last != first) {
+		rows[nrows++] = last;
+	}
+	int left = GridCell(people, x - BEACH_TOWEL_WIDTH, y) % BEACH_GRID_COLUMNS;
+	int right = GridCell(people, x, y) % BEACH_GRID_COLUMNS;
+
+	for (int r = 0; r < nrows; r++) {
+		for (int c = left; c <= right; c++) {
+			for (int i = people->grid[rows[r] * BEACH_GRID_COLUMNS + c]; i != -1; i = people->next[i]) {
+				if ((result == -1 || i < result) && !people->satisfied[i] && OnTowel(people, i, x, y)) {
+					result = i;
+				}
+			}
+		}
+	}
+	return result;
+}
+
+int BeachSimFindTowelSlow(const struct BeachSim* sim, int x, int y) {
+	// Reference implementation of BeachSimFindTowel.
+	for (int i = 0; i < sim->people.count; i++) {
+		if (!sim->people.satisfied[i] && OnTowel(&sim->people, i, x, y)) {
+			return i;
+		}
+	}
+	return -1;
+}
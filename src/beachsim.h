@@ -0,0 +1,203 @@
+/*! \file beachsim.h
+ *  \brief Display-less simulation core of the beach gamestate.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BEACHSIM_H
+#define BEACHSIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BEACH_WIDTH 160
+#define BEACH_HEIGHT 90
+#define BEACH_PEOPLE 6 // default crowd size
+#define BEACH_MAX_PEOPLE 100000
+#define BEACH_MAX_CORNS 16 // in flight at once, with rapid fire
+
+// the simulation advances in fixed steps of this length
+#define BEACH_TICK (1.0 / 60.0)
+// When simulating in real time falls behind by more than this many ticks, the game slows down instead of trying to catch up.
+#define BEACH_MAX_CATCHUP_TICKS 8
+
+// size of towel*.png
+#define BEACH_TOWEL_WIDTH 34
+#define BEACH_TOWEL_HEIGHT 15
+
+// The sea's phase is frames / 64 radians modulo pi, kept in units of 2^-60 radians.
+#define BEACH_SEA_PHASE_STEP (1ull << 54) // 1/64 radians
+#define BEACH_SEA_PHASE_PI 0x3243F6A8885A308Dull
+
+// where the guy stands, as passed to SetCharacterPosition
+#define BEACH_GUY_X 27
+#define BEACH_GUY_Y 42
+// where thrown corn starts flying from
+#define BEACH_CORN_X (BEACH_GUY_X + 10)
+#define BEACH_CORN_Y (BEACH_GUY_Y + 5)
+
+/*! \brief Things that happened during a simulation step which the presentation layer may want to react to. */
+enum BeachEvent {
+	BEACH_EVENT_CORN = 1 << 0, /*!< "Boiled corn!" should be shouted; see BeachSim::corn. */
+	BEACH_EVENT_START = 1 << 1, /*!< A session has started. */
+	BEACH_EVENT_END = 1 << 2, /*!< The session has ended. */
+	BEACH_EVENT_THROW = 1 << 3, /*!< A corn has been thrown. */
+	BEACH_EVENT_HIT = 1 << 4, /*!< A corn has landed on a towel. */
+	BEACH_EVENT_MISS = 1 << 5, /*!< BeachSim::lost corns have been lost at BeachSim::lostx, BeachSim::losty. */
+	BEACH_EVENT_STEP = 1 << 6, /*!< The beach has scrolled by one pixel. */
+};
+
+/*! \brief Per-instance pseudo-random number generator. */
+struct BeachRandom {
+	uint64_t state;
+};
+
+/*! \brief Inputs requested by BeachAutoplay, to be applied in this order. */
+enum BeachInput {
+	BEACH_INPUT_PRESS = 1 << 0,
+	BEACH_INPUT_RELEASE = 1 << 1,
+};
+
+/*! \brief Scripted player that keeps throwing corn with random power. */
+struct BeachAutoplayer {
+	struct BeachRandom random;
+	int hold;
+	int max_hold; /*!< Longest time to charge a throw for, in ticks. */
+	bool once; /*!< Stays on the score screen after the first session instead of starting another one. */
+};
+
+// Towels are indexed in a grid which scrolls along with them, so only respawning moves them between cells.
+#define BEACH_GRID_CELL 16
+#define BEACH_GRID_ROWS 8 // 128 rows, enough for the 116 rows people scroll through
+#define BEACH_GRID_COLUMNS (BEACH_WIDTH / BEACH_GRID_CELL)
+
+/*! \brief Beachgoers, stored as a structure of arrays so that scrolling them is a plain loop over `y`. */
+struct BeachPeople {
+	int count;
+	int* x;
+	int* y;
+	uint8_t* satisfied;
+	uint8_t* boy;
+	uint8_t* towel;
+
+	// doubly linked lists of people whose towel's top left corner is in each grid cell
+	int grid[BEACH_GRID_ROWS * BEACH_GRID_COLUMNS];
+	int* cell;
+	int* next;
+	int* prev;
+	int shift; /*!< Rows scrolled so far, modulo the grid height. */
+};
+
+/*! \brief A thrown corn, flying right until it reaches its target. */
+struct BeachCorn {
+	bool active;
+	float x;
+	int y;
+	int target;
+};
+
+/*! \brief Tunable rules of the beach. BeachDefaultParams are the ones the game is played with. */
+struct BeachParams {
+	int max_power; /*!< Power a throw stops charging at, in ticks. */
+	int throw_speed; /*!< Pixels a corn flies by every tick. */
+	int scroll_ticks; /*!< Ticks between the beach scrolling by a row. */
+	int satisfied_chance; /*!< One in this many people arrive already satisfied, or nobody if 0. */
+	int throws; /*!< Corns per session. */
+	int spawn_x; /*!< Leftmost position of a towel. */
+	int spawn_width; /*!< Range of towel positions right of `spawn_x`. */
+};
+
+extern const struct BeachParams BeachDefaultParams;
+
+/*! \brief Complete state of the beach game logic. */
+struct BeachSim {
+	struct BeachRandom random;
+	struct BeachParams params; /*!< Not a part of the hash, as replays are only recorded with the defaults. */
+
+	bool started;
+	bool started_once;
+	int frames;
+	int counter;
+	struct BeachPeople people;
+	int power;
+	int left;
+	bool preparing;
+	int throwing; /*!< Number of active corns. */
+	struct BeachCorn corns[BEACH_MAX_CORNS]; /*!< Without rapid fire, only the first one is ever used. */
+	bool rapid_fire; /*!< Whether another corn can be thrown while some are still flying. */
+	int score;
+	int sandx;
+	int seax;
+	int seay;
+	int maxsea;
+	int sandleft;
+	uint64_t seaphase; /*!< Follows `frames`, so it's not a part of the hash. */
+	int prevsandx, prevseax; /*!< From before the last tick, for interpolating; not a part of the hash either. */
+
+	int corn; /*!< Which corn sample to play with BEACH_EVENT_CORN. */
+	int lost; /*!< Number of corns lost during the last tick. */
+	int lostx[BEACH_MAX_CORNS], losty[BEACH_MAX_CORNS]; /*!< Where the lost corns should be left with BEACH_EVENT_MISS. */
+	unsigned int events; /*!< Bitmask of BeachEvent, to be cleared by the caller. */
+};
+
+/*! \brief Everything needed to draw the beach, without access to the rest of the simulation. */
+struct BeachSnapshot {
+	bool started;
+	bool started_once;
+	bool preparing;
+	int throwing;
+	int power;
+	int left;
+	int score;
+	int counter; /*!< Ticks since the beach has last scrolled. */
+	int scroll_ticks;
+	int throw_speed;
+	int sandx, prevsandx;
+	int seax, prevseax;
+	int seay;
+	int sandleft;
+	struct BeachCorn corns[BEACH_MAX_CORNS];
+
+	int people;
+	const int* x;
+	const int* y;
+	const uint8_t* satisfied;
+	const uint8_t* boy;
+	const uint8_t* towel;
+};
+
+void BeachRandomSeed(struct BeachRandom* random, uint64_t seed);
+int BeachRandomNext(struct BeachRandom* random, int max);
+
+void BeachAutoplayerInit(struct BeachAutoplayer* player, uint64_t seed, int max_hold);
+unsigned int BeachAutoplay(struct BeachAutoplayer* player, const struct BeachSim* sim);
+
+void BeachSimInit(struct BeachSim* sim, uint64_t seed, int people);
+void BeachSimInitWithParams(struct BeachSim* sim, uint64_t seed, int people, const struct BeachParams* params);
+void BeachSimDestroy(struct BeachSim* sim);
+void BeachSimTick(struct BeachSim* sim);
+void BeachSimPress(struct BeachSim* sim);
+void BeachSimRelease(struct BeachSim* sim);
+uint64_t BeachSimHash(const struct BeachSim* sim);
+void BeachSnapshotView(struct BeachSnapshot* snapshot, const struct BeachSim* sim);
+
+int BeachSeaWave(uint64_t phase);
+
+int BeachSimFindTowel(const struct BeachSim* sim, int x, int y);
+int BeachSimFindTowelSlow(const struct BeachSim* sim, int x, int y);
+
+#endif
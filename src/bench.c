@@ -0,0 +1,209 @@
+/*! \file bench.c
+ *  \brief Scripted benchmark scenarios for the beach.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+#include "allocs.h"
+#include "beachsim.h"
+#include "profiler.h"
+#include <string.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+static const struct BenchScenario scenarios[] = {
+	{"intro", "dosowisko", 300, 0, false, 0, false}, // from the start until it fades out
+	{"idle", "beach", 0, BEACH_PEOPLE, false, 0, false}, // title screen
+	{"session", "beach", 0, BEACH_PEOPLE, false, 32, true}, // all the throws of a session, then its score screen
+	{"crowd", "beach", 0, BEACH_MAX_PEOPLE, false, 32, false}, // one throw after another, charged for up to 32 ticks
+	{"rapid", "beach", 0, BEACH_PEOPLE, true, 2, false}, // mashing the button with rapid fire
+};
+
+#define SCENARIOS (int)(sizeof(scenarios) / sizeof(scenarios[0]))
+
+static const struct BenchScenario* FindScenario(const char* name) {
+	for (int i = 0; i < SCENARIOS; i++) {
+		if (strcmp(scenarios[i].name, name) == 0) {
+			return &scenarios[i];
+		}
+	}
+	return NULL;
+}
+
+bool IsBenchScenario(const char* name) {
+	return (strcmp(name, "all") == 0) || FindScenario(name);
+}
+
+const char* GetBenchGamestate(const char* name) {
+	// the one to start the game with, as scenarios switch between gamestates by themselves
+	if (strcmp(name, "all") == 0) {
+		return scenarios[0].gamestate;
+	}
+	return FindScenario(name)->gamestate;
+}
+
+void PrintBenchScenarios(FILE* file) {
+	fprintf(file, "Available benchmark scenarios: all");
+	for (int i = 0; i < SCENARIOS; i++) {
+		fprintf(file, ", %s", scenarios[i].name);
+	}
+	fprintf(file, "\n");
+}
+
+static long long GetHeapInUse(void) {
+#if defined(__GLIBC__) && ((__GLIBC__ > 2) || (__GLIBC_MINOR__ >= 33))
+	struct mallinfo2 info = mallinfo2();
+	return (long long)info.uordblks;
+#else
+	return -1;
+#endif
+}
+
+static long GetPeakRSS(void) {
+#ifdef __linux__
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+		return usage.ru_maxrss; // in kilobytes
+	}
+#endif
+	return -1;
+}
+
+struct Bench* CreateBench(const char* scenario, int frames, const char* output) {
+	struct Bench* bench = calloc(1, sizeof(struct Bench));
+	if (strcmp(scenario, "all") == 0) {
+		bench->scenario = &scenarios[0];
+		bench->last = &scenarios[SCENARIOS - 1];
+	} else {
+		bench->scenario = bench->last = FindScenario(scenario);
+	}
+	bench->frames = (frames > 0) ? frames : BENCH_FRAMES;
+	bench->output = output ? fopen(output, "w") : NULL;
+	if (!bench->output) {
+		bench->output = stdout;
+	}
+	fprintf(bench->output, "{\"scenarios\":[");
+	return bench;
+}
+
+bool FinishBench(struct Bench* bench) {
+	// Like FinishGolden, doesn't need Allegro anymore.
+	bool passed = !bench->failed;
+	fprintf(bench->output, "\n]}\n");
+	if (bench->output != stdout) {
+		fclose(bench->output);
+	}
+	free(bench);
+	return passed;
+}
+
+void BenchStart(struct Bench* bench, struct Profiler* profiler) {
+	bench->drawn = 0;
+	bench->until = 0;
+	bench->running = true;
+	bench->start = al_get_time();
+	bench->heap = GetHeapInUse();
+	bench->allocations = GetAllocationCount();
+	bench->steady_allocations = 0;
+	bench->max_allocations = 0;
+	bench->allocating_frames = 0;
+	ProfilerReset(profiler);
+}
+
+static void Report(struct Bench* bench, struct Profiler* profiler) {
+	// Only the latest PROFILER_SAMPLES samples are kept, so very long runs report their tail end.
+	FILE* file = bench->output;
+	double seconds = al_get_time() - bench->start;
+	long long heap = GetHeapInUse();
+
+	fprintf(file, "%s\n{\"name\":\"%s\",\"people\":%d,\"rapid_fire\":%s,\"frames\":%d,\"seconds\":%.3f,\"fps\":%.2f", bench->reported++ ? "," : "",
+		bench->scenario->name, bench->scenario->people, bench->scenario->rapid_fire ? "true" : "false", bench->drawn, seconds,
+		seconds > 0 ? bench->drawn / seconds : 0.0);
+	const struct {
+		const char* name;
+		enum ProfilerSection section;
+	} sections[] = {{"frame", PROFILER_FRAME}, {"logic", PROFILER_LOGIC}, {"tick", PROFILER_TICK}, {"draw", PROFILER_DRAW}};
+	for (size_t i = 0; i < sizeof(sections) / sizeof(sections[0]); i++) {
+		fprintf(file, ",\"%s\":", sections[i].name);
+		ProfilerWriteStats(profiler, sections[i].section, file);
+	}
+	if ((heap >= 0) && (bench->heap >= 0)) {
+		fprintf(file, ",\"heap_growth_bytes\":%lld", heap - bench->heap);
+	} else {
+		fprintf(file, ",\"heap_growth_bytes\":null");
+	}
+	if (IsAllocationTrackingEnabled()) {
+		if (bench->allocating_frames) {
+			fprintf(stderr, "%s: %d frames allocated memory after the warmup\n", bench->scenario->name, bench->allocating_frames);
+			bench->failed++;
+		}
+		fprintf(file, ",\"allocations\":{\"steady\":%llu,\"max_per_frame\":%llu,\"allocating_frames\":%d}",
+			(unsigned long long)bench->steady_allocations, (unsigned long long)bench->max_allocations, bench->allocating_frames);
+	} else {
+		fprintf(file, ",\"allocations\":null");
+	}
+	long rss = GetPeakRSS();
+	if (rss >= 0) {
+		fprintf(file, ",\"peak_rss_kb\":%ld}", rss);
+	} else {
+		fprintf(file, ",\"peak_rss_kb\":null}");
+	}
+	fflush(file);
+}
+
+bool BenchFrameDrawn(struct Bench* bench, struct Profiler* profiler) {
+	if (!bench->running) {
+		return false;
+	}
+	uint64_t allocations = GetAllocationCount();
+	if (++bench->drawn > BENCH_WARMUP) {
+		uint64_t count = allocations - bench->allocations;
+		bench->steady_allocations += count;
+		if (count > bench->max_allocations) {
+			bench->max_allocations = count;
+		}
+		bench->allocating_frames += count > 0;
+	}
+	bench->allocations = allocations;
+	if (bench->scenario->session) {
+		// ends only once BenchEndAfter has been called, however long the session takes
+		if (!bench->until || (bench->drawn < bench->until)) {
+			return false;
+		}
+	} else if (bench->drawn < (bench->scenario->frames ? bench->scenario->frames : bench->frames)) {
+		return false;
+	}
+	Report(bench, profiler);
+	bench->running = false;
+	if (bench->scenario == bench->last) {
+		bench->scenario = NULL;
+		return true;
+	}
+	bench->scenario++;
+	return false;
+}
+
+void BenchEndAfter(struct Bench* bench, int frames) {
+	if (bench->running && !bench->until) {
+		bench->until = bench->drawn + frames;
+	}
+}
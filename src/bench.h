@@ -0,0 +1,73 @@
+/*! \file bench.h
+ *  \brief Scripted benchmark scenarios for the beach.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "common.h"
+#include <stdio.h>
+
+#define BENCH_FRAMES 600 // drawn in each scenario by default
+#define BENCH_WARMUP 60 // frames after which nothing should allocate anymore
+#define BENCH_SCORE_FRAMES 120 // drawn after the end of a session in scenarios which last one
+#define BENCH_SEED 1
+
+struct Profiler;
+
+struct BenchScenario {
+	const char* name;
+	const char* gamestate; /*!< Which one gets benchmarked; it has to call BenchStart. */
+	int frames; /*!< Drawn regardless of --bench-frames, for scenarios which can't last any longer; 0 if they can. */
+	int people;
+	bool rapid_fire;
+	int max_hold; /*!< Passed to BeachAutoplayerInit, 0 to never touch the controls. */
+	bool session; /*!< Lasts one whole session and BENCH_SCORE_FRAMES frames of its score screen instead of a number of frames. */
+};
+
+/*! \brief Runs one or all scenarios in a row, each for a given number of frames or a whole session, and reports them as JSON. */
+struct Bench {
+	const struct BenchScenario* scenario; /*!< The one being run, NULL when all of them are done. */
+	const struct BenchScenario* last;
+	int frames;
+	int drawn;
+	int until; /*!< Frame to end the scenario after, when set by BenchEndAfter. */
+	bool running;
+	double start;
+	long long heap;
+	uint64_t allocations; /*!< GetAllocationCount at the end of the last frame. */
+	uint64_t steady_allocations; /*!< Made after the warmup. */
+	uint64_t max_allocations; /*!< Most made during a single frame after the warmup. */
+	int allocating_frames; /*!< Frames after the warmup which made any allocations. */
+	FILE* output;
+	int reported;
+	int failed; /*!< Scenarios which allocated after the warmup, when allocations are tracked. */
+};
+
+bool IsBenchScenario(const char* name);
+const char* GetBenchGamestate(const char* name);
+void PrintBenchScenarios(FILE* file);
+
+struct Bench* CreateBench(const char* scenario, int frames, const char* output);
+bool FinishBench(struct Bench* bench);
+void BenchStart(struct Bench* bench, struct Profiler* profiler);
+bool BenchFrameDrawn(struct Bench* bench, struct Profiler* profiler);
+void BenchEndAfter(struct Bench* bench, int frames);
+
+#endif
@@ -19,6 +19,11 @@
  */
 
 #include "common.h"
+#include "assetpack.h"
+#include "bench.h"
+#include "loader.h"
+#include "profiler.h"
+#include "replay.h"
 #include <libsuperderpy.h>
 
 bool GlobalEventHandler(struct Game* game, ALLEGRO_EVENT* ev) {
@@ -30,6 +35,10 @@ bool GlobalEventHandler(struct Game* game, ALLEGRO_EVENT* ev) {
 		ToggleFullscreen(game);
 	}
 
+	if ((ev->type == ALLEGRO_EVENT_KEY_DOWN) && (ev->keyboard.keycode == ALLEGRO_KEY_P)) {
+		game->data->profiler->overlay = !game->data->profiler->overlay;
+	}
+
 #ifdef ALLEGRO_ANDROID
 	if ((ev->type == ALLEGRO_EVENT_KEY_DOWN) && (ev->keyboard.keycode == ALLEGRO_KEY_BACK)) {
 		QuitGame(game, true);
@@ -39,11 +48,71 @@ bool GlobalEventHandler(struct Game* game, ALLEGRO_EVENT* ev) {
 	return false;
 }
 
-struct CommonResources* CreateGameData(struct Game* game) {
+void PreLogic(struct Game* game, double delta) {
+	ProfilerBegin(game->data->profiler, PROFILER_LOGIC);
+}
+
+void PostLogic(struct Game* game, double delta) {
+	ProfilerEnd(game->data->profiler, PROFILER_LOGIC);
+}
+
+void PreDraw(struct Game* game) {
+	struct Profiler* profiler = game->data->profiler;
+	if (profiler->begin[PROFILER_DRAW] > 0) {
+		// a frame lasts from the start of one draw to the start of the next one
+		ProfilerRecord(profiler, PROFILER_FRAME, profiler->begin[PROFILER_DRAW], al_get_time() - profiler->begin[PROFILER_DRAW]);
+	}
+	ProfilerBegin(profiler, PROFILER_DRAW);
+}
+
+void PostDraw(struct Game* game) {
+	ProfilerEnd(game->data->profiler, PROFILER_DRAW);
+	ProfilerDrawOverlay(game->data->profiler);
+	if (game->data->bench && BenchFrameDrawn(game->data->bench, game->data->profiler)) {
+		QuitGame(game, false);
+	}
+}
+
+struct CommonResources* CreateGameData(struct Game* game, struct CommonOptions options) {
 	struct CommonResources* data = calloc(1, sizeof(struct CommonResources));
+	if (options.record) {
+		data->recorder = ReplayWriterOpen(options.record);
+		if (!data->recorder) {
+			PrintConsole(game, "Cannot open %s for recording!", options.record);
+		}
+	}
+	data->profiler = CreateProfiler();
+	char* pack = FindDataFilePath(game, ASSETPACK_FILENAME);
+	if (pack) {
+		data->pack = OpenAssetPack(pack);
+		if (!data->pack) {
+			PrintConsole(game, "Cannot open asset pack %s, falling back to loose files.", pack);
+		}
+	}
+	data->trace = options.trace;
+	data->loader_threads = (options.loader_threads < 0) ? al_get_cpu_count() : options.loader_threads;
+	data->startup_bench = options.startup_bench;
+	data->people = options.people;
+	data->rapid_fire = options.rapid_fire;
+	data->sim_thread = options.sim_thread;
+	data->bench = options.bench;
+	data->golden = options.golden;
 	return data;
 }
 
 void DestroyGameData(struct Game* game) {
+	if (game->data->recorder) {
+		ReplayWriterClose(game->data->recorder);
+	}
+	if (game->data->trace && !ProfilerWriteTrace(game->data->profiler, game->data->trace)) {
+		PrintConsole(game, "Cannot write trace to %s!", game->data->trace);
+	}
+	if (game->data->prefetch) {
+		DestroyPrefetch(game->data->prefetch);
+	}
+	DestroyProfiler(game->data->profiler);
+	if (game->data->pack) {
+		CloseAssetPack(game->data->pack);
+	}
 	free(game->data);
 }
@@ -15,14 +15,51 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#ifndef COMMON_H
+#define COMMON_H
+
 #define LIBSUPERDERPY_DATA_TYPE struct CommonResources
 #include <libsuperderpy.h>
 
+// Native resolution which gamestates draw at, before it gets upscaled to the window.
+#define VIEWPORT_WIDTH 160
+#define VIEWPORT_HEIGHT 90
+
+/*! \brief Command line options handled by the game itself rather than by the engine. */
+struct CommonOptions {
+	const char* record; // where to record beach input to
+	const char* trace; // where to write the Chrome trace to on exit
+	int loader_threads; // how many threads to decode assets with, negative for one per CPU
+	bool startup_bench; // start the beach right away and quit after its first frame
+	int people; // crowd size on the beach
+	bool rapid_fire; // allow throwing another corn while the previous ones are still flying
+	bool sim_thread; // step the beach on its own thread instead of before each frame
+	struct Bench* bench; // runs benchmark scenarios, owned by main so that it can set the exit status
+	struct Golden* golden; // checks benchmarked frames, owned by main for the same reason
+};
+
 struct CommonResources {
 	// Fill in with common data accessible from all gamestates.
-	bool unused;
+	struct ReplayWriter* recorder;
+	struct Profiler* profiler;
+	struct AssetPack* pack; // pre-decoded assets, NULL when running from loose files
+	struct Bench* bench; // NULL unless benchmarking
+	struct Golden* golden; // NULL unless checking frames against reference images
+	struct Prefetch* prefetch; // assets of the next gamestate, decoded while the current one runs
+	const char* trace;
+	int loader_threads;
+	bool startup_bench;
+	int people;
+	bool rapid_fire;
+	bool sim_thread;
 };
 
-struct CommonResources* CreateGameData(struct Game* game);
+struct CommonResources* CreateGameData(struct Game* game, struct CommonOptions options);
 void DestroyGameData(struct Game* game);
 bool GlobalEventHandler(struct Game* game, ALLEGRO_EVENT* ev);
+void PreLogic(struct Game* game, double delta);
+void PostLogic(struct Game* game, double delta);
+void PreDraw(struct Game* game);
+void PostDraw(struct Game* game);
+
+#endif
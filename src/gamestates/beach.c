@@ -18,228 +18,407 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "../atlas.h"
+#include "../beachsim.h"
+#include "../bench.h"
 #include "../common.h"
+#include "../golden.h"
+#include "../layercache.h"
+#include "../loader.h"
+#include "../profiler.h"
+#include "../replay.h"
+#include "../simthread.h"
+#include "../textcache.h"
+#include "../upscale.h"
+#include "../voices.h"
 #include <libsuperderpy.h>
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 struct GamestateResources {
 	// This struct is for every resource allocated and used by your gamestate.
 	// It gets created on load and then gets passed around to all other function calls.
 	ALLEGRO_FONT* font;
+	struct TextCache text;
+	struct DigitStrip digits; // for the score, which changes too often to be cached as a whole
+
+	struct BeachSim sim;
+	double accumulator; // time not simulated yet
+	bool threaded; // whether the simulation is stepped by `thread` rather than by Gamestate_Logic
+	struct SimThread thread;
+	const struct SimSnapshot* snapshot; // newest one taken from the thread
+	struct BeachSnapshot view; // what's being drawn, pointing either into the simulation or into the snapshot
+	struct {
+		int value;
+		char text[12];
+	} score; // formatted only when it changes
+	const struct BenchScenario* scenario; // being benchmarked, if any
+	struct BeachAutoplayer autoplayer; // plays in benchmark scenarios
 
-	bool started;
-	bool started_once;
-	int frames;
-	int counter;
+	ALLEGRO_BITMAP* atlas; // all bitmaps below are sub-bitmaps of it, so that drawing them can be batched
 	ALLEGRO_BITMAP *boy, *cloud, *girl, *lost, *off, *on, *overlay, *sand, *sea, *corn, *pow;
 	ALLEGRO_BITMAP* towels[3];
-	ALLEGRO_BITMAP *canvas, *tmp;
-	struct {
-		int x, y;
-		bool satisfied;
-		ALLEGRO_BITMAP *human, *towel;
-	} people[6];
-	int power;
-	int left;
-	bool preparing;
-	bool throwing;
-	float throwx;
-	int throwy;
-	int target;
-	int score;
-	int sandx;
-	int seax;
-	int seay;
-	int maxsea;
-	int sandleft;
-	bool seain;
+	ALLEGRO_BITMAP* canvas;
+	ALLEGRO_BITMAP* screen; // everything is drawn here at a few times the native resolution at most, then upscaled
+	struct LayerCache overlays; // both copies of the overlay, one row taller than the screen on both sides
+	int canvasy; // scroll offset of the canvas, which is used as a ring buffer
 	struct Character* guy;
 
 	ALLEGRO_AUDIO_STREAM *seanoise, *music;
-	ALLEGRO_SAMPLE *win_sample, *lose_sample, *throw_sample, *corn_sample[3];
-	ALLEGRO_SAMPLE_INSTANCE *win, *lose, *thr, *boiledcorn[3];
+	ALLEGRO_SAMPLE *win_sample, *lose_sample, *throw_sample;
+	ALLEGRO_SAMPLE_INSTANCE *win, *lose, *thr;
+	struct VoicePool voices; // the corn clips are too long to be kept decoded
+	int boiledcorn[3];
 };
 
-int Gamestate_ProgressCount = 3; // number of loading steps as reported by Gamestate_Load
+int Gamestate_ProgressCount = 23; // number of loading steps as reported by Gamestate_Load, one per queued asset and six more
 
-void Gamestate_Logic(struct Game* game, struct GamestateResources* data, double delta) {
-	// TODO: move stuff from Tick to Logic
+static void ScrollCanvas(struct Game* game, struct GamestateResources* data) {
+	// Instead of moving the whole canvas down, move its origin and clear the row that wraps around to the top.
+	data->canvasy = (data->canvasy + 1) % VIEWPORT_HEIGHT;
+	al_set_target_bitmap(data->canvas);
+	al_set_clipping_rectangle(0, (VIEWPORT_HEIGHT - data->canvasy) % VIEWPORT_HEIGHT, VIEWPORT_WIDTH, 1);
+	al_clear_to_color(al_map_rgba(0, 0, 0, 0));
+	al_reset_clipping_rectangle();
+	al_set_target_backbuffer(game->display);
 }
 
-void Gamestate_Tick(struct Game* game, struct GamestateResources* data) {
-	// Called 60 times per second. Here you should do all your game logic.
-	double delta = 1.0 / 60.0;
-
-	data->frames++;
-	data->counter++;
-	if (data->preparing) {
-		data->power++;
-		if (data->power > 32) {
-			data->power = 32;
-		}
+static void DrawOnCanvas(struct Game* game, struct GamestateResources* data, ALLEGRO_BITMAP* bitmap, float x, float y) {
+	// Translate screen coordinates into the canvas ring buffer; draw twice so that decals crossing the seam wrap.
+	float cy = fmod(y - data->canvasy, VIEWPORT_HEIGHT);
+	if (cy < 0) {
+		cy += VIEWPORT_HEIGHT;
 	}
-	if (data->throwing) {
-		data->throwx += 2;
-		if (data->throwx >= data->target) {
-			data->throwing = false;
-			data->preparing = false;
-			data->left--;
-
-			bool fine = false;
-			for (int i = 0; i < 6; i++) {
-				int x = (int)data->throwx;
-				int y = data->throwy + 2;
-				int x1 = data->people[i].x, y1 = data->people[i].y;
-				int x2 = x1 + al_get_bitmap_width(data->people[i].towel), y2 = y1 + al_get_bitmap_height(data->people[i].towel);
-
-				fine = ((x >= x1) && (x <= x2) && (y >= y1) && (y <= y2));
-				if (fine && !data->people[i].satisfied) {
-					data->people[i].satisfied = true;
-					break;
-				}
-			}
-			if (!fine) {
-				al_set_target_bitmap(data->canvas);
-				al_draw_bitmap(data->lost, data->throwx, data->throwy - 3, 0);
-				al_set_target_backbuffer(game->display);
-				data->score--;
-				al_play_sample_instance(data->lose);
-			} else {
-				al_play_sample_instance(data->win);
-				data->score++;
-			}
-
-			if (data->left == 0) {
-				al_set_audio_stream_playing(data->music, false);
-				data->started = false;
-			}
-		}
+	al_set_target_bitmap(data->canvas);
+	al_draw_bitmap(bitmap, x, cy, 0);
+	al_draw_bitmap(bitmap, x, cy - VIEWPORT_HEIGHT, 0);
+	al_set_target_backbuffer(game->display);
+}
+
+static void DrawCanvas(struct GamestateResources* data, float offset) {
+	al_draw_bitmap_region(data->canvas, 0, 0, VIEWPORT_WIDTH, VIEWPORT_HEIGHT - data->canvasy, 0, data->canvasy + offset, 0);
+	if (data->canvasy) {
+		al_draw_bitmap_region(data->canvas, 0, VIEWPORT_HEIGHT - data->canvasy, VIEWPORT_WIDTH, data->canvasy, 0, offset, 0);
 	}
+}
 
-	if ((data->started) && (data->counter >= 8)) {
-		data->counter = 0;
-		AnimateCharacter(game, data->guy, delta, 1);
-		data->seay++;
+static void HandleSimEvents(struct Game* game, struct GamestateResources* data, const struct SimEvents* reported) {
+	// Play sounds and update the presentation for whatever the simulation reported.
+	unsigned int events = reported->events;
 
-		al_set_target_bitmap(data->tmp);
-		al_clear_to_color(al_map_rgba(0, 0, 0, 0));
-		al_draw_bitmap(data->canvas, 0, 0, 0);
+	if (events & BEACH_EVENT_START) {
+		al_rewind_audio_stream(data->music);
+		al_set_audio_stream_playing(data->music, true);
 		al_set_target_bitmap(data->canvas);
 		al_clear_to_color(al_map_rgba(0, 0, 0, 0));
-		al_draw_bitmap(data->tmp, 0, 1, 0);
 		al_set_target_backbuffer(game->display);
-
-		if (data->throwing) {
-			data->throwy++;
+		SelectSpritesheet(game, data->guy, "walk");
+	}
+	if (events & BEACH_EVENT_THROW) {
+		al_play_sample_instance(data->thr);
+	}
+	if (events & BEACH_EVENT_MISS) {
+		for (int i = 0; i < reported->lost; i++) {
+			DrawOnCanvas(game, data, data->lost, reported->lostx[i], reported->losty[i]);
 		}
-
-		for (int i = 0; i < 6; i++) {
-			data->people[i].y++;
-			if (data->people[i].y > 95) {
-				data->people[i].y = -20 + (rand() % 5);
-				data->people[i].human = (rand() % 2) ? data->boy : data->girl;
-				data->people[i].towel = data->towels[rand() % 3];
-				data->people[i].satisfied = false;
-				if (rand() % 10 == 0) {
-					data->people[i].satisfied = true;
-				}
-				if ((i != 0) && (i != 5)) {
-					data->people[i].x = (rand() % 100) + 45;
-				}
-			}
+		al_play_sample_instance(data->lose);
+	}
+	if (events & BEACH_EVENT_HIT) {
+		al_play_sample_instance(data->win);
+	}
+	if (events & BEACH_EVENT_END) {
+		al_set_audio_stream_playing(data->music, false);
+		if (data->scenario && data->scenario->session) {
+			BenchEndAfter(game->data->bench, BENCH_SCORE_FRAMES);
 		}
 	}
-	if (data->seay == 120) {
-		data->seay = 0;
-		al_play_sample_instance(data->boiledcorn[rand() % 3]);
+	if (events & BEACH_EVENT_STEP) {
+		AnimateCharacter(game, data->guy, 1.0 / 60.0, 1);
+		ScrollCanvas(game, data);
+	}
+	if (events & BEACH_EVENT_CORN) {
+		PlayVoiceClip(&data->voices, data->boiledcorn[reported->corn]);
+	}
+}
+
+static void FlushSimEvents(struct Game* game, struct GamestateResources* data) {
+	struct SimEvents events;
+	TakeSimEvents(&events, &data->sim);
+	HandleSimEvents(game, data, &events);
+}
+
+static void SyncThread(struct Game* game, struct GamestateResources* data) {
+	// Take the newest snapshot and catch up with everything that happened until it.
+	data->snapshot = SimThreadAcquire(&data->thread);
+	struct SimEvents events;
+	while (SimThreadPollEvents(&data->thread, data->snapshot->serial, &events)) {
+		HandleSimEvents(game, data, &events);
+	}
+}
+
+static void StartThread(struct Game* game, struct GamestateResources* data) {
+	if (!data->threaded) {
+		return;
+	}
+	struct BeachAutoplayer* autoplayer = (data->scenario && data->scenario->max_hold) ? &data->autoplayer : NULL;
+	if (!StartSimThread(&data->thread, &data->sim, autoplayer, game->data->recorder, game->data->profiler)) {
+		PrintConsole(game, "Cannot start the simulation thread, falling back to stepping it before drawing.");
+		data->threaded = false;
+		return;
+	}
+	data->snapshot = SimThreadAcquire(&data->thread);
+}
+
+static void StopThread(struct Game* game, struct GamestateResources* data) {
+	if (!data->thread.thread) {
+		return;
+	}
+	StopSimThread(&data->thread);
+	SyncThread(game, data);
+}
+
+static void Record(struct Game* game, struct GamestateResources* data, enum ReplayRecordType type, uint64_t value) {
+	if (game->data->recorder) {
+		ReplayWrite(game->data->recorder, data->sim.frames, type, value);
+	}
+}
+
+static void Press(struct Game* game, struct GamestateResources* data) {
+	if (data->thread.thread) {
+		SimThreadInput(&data->thread, BEACH_INPUT_PRESS);
+		return;
+	}
+	Record(game, data, REPLAY_PRESS, 0);
+	BeachSimPress(&data->sim);
+	FlushSimEvents(game, data);
+}
+
+static void Release(struct Game* game, struct GamestateResources* data) {
+	if (data->thread.thread) {
+		SimThreadInput(&data->thread, BEACH_INPUT_RELEASE);
+		return;
+	}
+	Record(game, data, REPLAY_RELEASE, 0);
+	BeachSimRelease(&data->sim);
+	FlushSimEvents(game, data);
+}
+
+static void Autoplay(struct Game* game, struct GamestateResources* data) {
+	if (!data->scenario->max_hold) {
+		return;
+	}
+	unsigned int input = BeachAutoplay(&data->autoplayer, &data->sim);
+	if (input & BEACH_INPUT_PRESS) {
+		Press(game, data);
+	}
+	if (input & BEACH_INPUT_RELEASE) {
+		Release(game, data);
 	}
-	data->seax = (int)(fabs(sin(data->frames / 64.0)) * 16);
-	if (data->seax == 15) {
-		data->maxsea = rand() % 7;
+}
+
+static void Reset(struct Game* game, struct GamestateResources* data) {
+	struct Bench* bench = game->data->bench;
+	data->scenario = (bench && bench->scenario && (strcmp(bench->scenario->gamestate, "beach") == 0)) ? bench->scenario : NULL;
+	uint64_t seed = data->scenario ? BENCH_SEED : (uint64_t)rand();
+	BeachSimDestroy(&data->sim);
+	BeachSimInit(&data->sim, seed, data->scenario ? data->scenario->people : game->data->people);
+	data->sim.rapid_fire = data->scenario ? data->scenario->rapid_fire : game->data->rapid_fire;
+	data->accumulator = 0;
+	data->score.text[0] = 0;
+	Record(game, data, REPLAY_PEOPLE, data->sim.people.count);
+	if (data->sim.rapid_fire) {
+		Record(game, data, REPLAY_RAPID_FIRE, 1);
+	}
+	Record(game, data, REPLAY_SEED, seed);
+	SetCharacterPosition(game, data->guy, BEACH_GUY_X, BEACH_GUY_Y, 0);
+	SelectSpritesheet(game, data->guy, "stand");
+	al_set_audio_stream_playing(data->music, false);
+	if (data->scenario) {
+		BeachAutoplayerInit(&data->autoplayer, ~seed, data->scenario->max_hold);
+		data->autoplayer.once = data->scenario->session;
+		BenchStart(bench, game->data->profiler);
+	}
+}
+
+void Gamestate_Logic(struct Game* game, struct GamestateResources* data, double delta) {
+	// Called as often as the game gets drawn. The simulation is stepped at a fixed rate regardless,
+	// and Gamestate_Draw interpolates between its last two states. With --sim-thread, it's stepped on its own
+	// thread instead and this only picks up the newest snapshot of it.
+	if (data->scenario && (data->scenario != game->data->bench->scenario)) {
+		if (!game->data->bench->scenario) {
+			return; // all done, about to quit
+		}
+		StopThread(game, data);
+		Reset(game, data);
+		FlushSimEvents(game, data);
+		StartThread(game, data);
 	}
-	data->seax = (int)fmax(data->seax, data->maxsea);
-	if (data->seax == data->maxsea) {
-		data->sandx = data->maxsea;
-		data->sandleft = 255;
+	if (data->threaded) {
+		SyncThread(game, data);
+		return;
 	}
-	data->sandleft -= 2;
-	if (data->sandleft < 0) {
-		data->sandleft = 0;
+	if (game->data->golden) {
+		delta = BEACH_TICK; // exactly one tick per frame, so that what gets drawn doesn't depend on timing
 	}
+	data->accumulator += delta;
+	int ticks = 0;
+	while (data->accumulator >= BEACH_TICK) {
+		if (ticks++ == BEACH_MAX_CATCHUP_TICKS) {
+			data->accumulator = 0;
+			break;
+		}
+		if (data->scenario) {
+			Autoplay(game, data);
+		}
+		ProfilerBegin(game->data->profiler, PROFILER_TICK);
+		BeachSimTick(&data->sim);
+		if (game->data->recorder) {
+			Record(game, data, REPLAY_HASH, BeachSimHash(&data->sim));
+		}
+		FlushSimEvents(game, data);
+		ProfilerEnd(game->data->profiler, PROFILER_TICK);
+		data->accumulator -= BEACH_TICK;
+	}
+}
+
+void Gamestate_Tick(struct Game* game, struct GamestateResources* data) {
+	// Everything happens in Gamestate_Logic.
 }
 
-static void DrawTextWithOutline(ALLEGRO_FONT* font, ALLEGRO_COLOR color, ALLEGRO_COLOR outline_color, float x, float y, int flags, const char* text) {
+static void DrawOverlay(struct Game* game, void* d) {
+	struct GamestateResources* data = d;
+	int y = data->view.seay + 1; // the cache starts a row above the screen
+
+	al_clear_to_color(al_map_rgba(0, 0, 0, 0));
 	al_hold_bitmap_drawing(true);
-	al_draw_text(font, outline_color, x + 1, y + 1, flags, text);
-	al_draw_text(font, outline_color, x - 1, y - 1, flags, text);
-	al_draw_text(font, outline_color, x + 1, y - 1, flags, text);
-	al_draw_text(font, outline_color, x - 1, y + 1, flags, text);
-	al_draw_text(font, outline_color, x - 1, y, flags, text);
-	al_draw_text(font, outline_color, x + 1, y, flags, text);
-	al_draw_text(font, outline_color, x, y - 1, flags, text);
-	al_draw_text(font, outline_color, x, y + 1, flags, text);
-	al_draw_text(font, color, x, y, flags, text);
+	//	for (int i=0; i<10; i++) {
+	al_draw_bitmap(data->overlay, 0, y - 120, 0);
+	al_draw_bitmap(data->overlay, 0, y, 0);
+	//	}
 	al_hold_bitmap_drawing(false);
 }
 
+static float Snap(float position, int detail) {
+	return roundf(position * detail) / detail;
+}
+
+static bool IsPersonVisible(int y) {
+	// the cloud sticks out the most, 13 pixels above the towel
+	return (y > -BEACH_TOWEL_HEIGHT - 1) && (y < BEACH_HEIGHT + 13);
+}
+
 void Gamestate_Draw(struct Game* game, struct GamestateResources* data) {
 	// Called as soon as possible, but no sooner than next Gamestate_Logic call.
 	// Draw everything to the screen here.
+	// What's drawn lags a tick behind the simulation, moving from its previous state towards the current one.
+	const struct BeachSnapshot* view = &data->view;
+	float alpha;
+	if (data->threaded) {
+		data->view = data->snapshot->state;
+		alpha = fmin((al_get_time() - data->snapshot->time) / BEACH_TICK, 1.0);
+	} else {
+		BeachSnapshotView(&data->view, &data->sim);
+		alpha = data->accumulator / BEACH_TICK;
+	}
+
+	// The screen is drawn at as many times the native resolution as the upscaling allows, up to UPSCALE_MAX_DETAIL,
+	// so that things can move by less than a native pixel. Positions are rounded to its pixels to keep them sharp.
+	// Golden images are compared at the native resolution.
+	int detail = game->data->golden ? 1 : GetUpscaleDetail(game, VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
+	if (al_get_bitmap_width(data->screen) != VIEWPORT_WIDTH * detail) {
+		al_destroy_bitmap(data->screen);
+		data->screen = CreateLowResTarget(VIEWPORT_WIDTH * detail, VIEWPORT_HEIGHT * detail);
+	}
+	al_set_target_bitmap(data->screen);
+	ALLEGRO_TRANSFORM transform;
+	al_identity_transform(&transform);
+	al_scale_transform(&transform, detail, detail);
+	al_use_transform(&transform);
+
+	// The beach moves by a row every scroll_ticks ticks, so the scroll offset spans that whole period. Once the
+	// session ends, the counter keeps going and the offset settles at zero, where everything stays until the next one.
+	float scroll = 0;
+	if (view->started_once) {
+		scroll = Snap(fmin(view->counter + alpha, view->scroll_ticks) / view->scroll_ticks - 1, detail);
+	}
+	float seax = Snap(view->prevseax + (view->seax - view->prevseax) * alpha, detail);
+	float sandx = Snap(view->prevsandx + (view->sandx - view->prevsandx) * alpha, detail);
+
+	// The sand fades and the sea wobbles nearly every tick, so they're drawn as they are. The overlay only moves
+	// when the beach scrolls, so it's composited into a cache and drawn on top of them with a single blit.
+	int params[] = {view->seay};
+	ALLEGRO_BITMAP* overlay = UpdateLayerCache(game, &data->overlays, params, 1, DrawOverlay, data);
+	ALLEGRO_COLOR sand = al_map_rgba(view->sandleft, view->sandleft, view->sandleft, view->sandleft);
 	al_clear_to_color(al_map_rgb(255, 234, 206));
-	al_draw_tinted_bitmap(data->sand, al_map_rgba(data->sandleft, data->sandleft, data->sandleft, data->sandleft), -data->sandx, data->seay, 0);
-	al_draw_bitmap(data->sea, -data->seax, data->seay, 0);
-	al_draw_tinted_bitmap(data->sand, al_map_rgba(data->sandleft, data->sandleft, data->sandleft, data->sandleft), -data->sandx, data->seay - 120, 0);
-	al_draw_bitmap(data->sea, -data->seax, data->seay - 120, 0);
 
-	//	for (int i=0; i<10; i++) {
-	al_draw_bitmap(data->overlay, 0, data->seay - 120, 0);
-	al_draw_bitmap(data->overlay, 0, data->seay, 0);
-	//	}
+	// Everything except the HUD bar is drawn from the atlas, the canvas, the font and the character,
+	// so holding lets Allegro batch consecutive draws from the same texture.
+	al_hold_bitmap_drawing(true);
+	al_draw_tinted_bitmap(data->sand, sand, -sandx, view->seay + scroll, 0);
+	al_draw_bitmap(data->sea, -seax, view->seay + scroll, 0);
+	al_draw_tinted_bitmap(data->sand, sand, -sandx, view->seay + scroll - 120, 0);
+	al_draw_bitmap(data->sea, -seax, view->seay + scroll - 120, 0);
+	al_draw_bitmap(overlay, 0, scroll - 1, 0);
 
 	DrawCharacter(game, data->guy);
 
-	for (int i = 0; i < 6; i++) {
-		al_draw_bitmap(data->people[i].towel, data->people[i].x, data->people[i].y, 0);
-		al_draw_bitmap(data->people[i].human, data->people[i].x + 5, data->people[i].y + 3, 0);
+	for (int i = 0; i < view->people; i++) {
+		if (!IsPersonVisible(view->y[i])) {
+			continue;
+		}
+		float y = view->y[i] + scroll;
+		al_draw_bitmap(data->towels[view->towel[i]], view->x[i], y, 0);
+		al_draw_bitmap(view->boy[i] ? data->boy : data->girl, view->x[i] + 5, y + 3, 0);
 	}
 
-	al_draw_bitmap(data->canvas, 0, 0, 0);
+	DrawCanvas(data, scroll);
 
-	for (int i = 0; i < 6; i++) {
-		if ((!data->people[i].satisfied) && (data->people[i].y > 13)) {
-			al_draw_bitmap(data->cloud, data->people[i].x - 1, data->people[i].y - 13, 0);
+	for (int i = 0; i < view->people; i++) {
+		if ((!view->satisfied[i]) && (view->y[i] > 13) && IsPersonVisible(view->y[i])) {
+			al_draw_bitmap(data->cloud, view->x[i] - 1, view->y[i] + scroll - 13, 0);
 		}
 	}
 
-	if (data->started_once) {
-		char score[255];
-		snprintf(score, 255, "%d", data->score);
+	if (view->started_once) {
+		if (!data->score.text[0] || (data->score.value != view->score)) {
+			data->score.value = view->score;
+			snprintf(data->score.text, sizeof(data->score.text), "%d", data->score.value);
+		}
+		const char* score = data->score.text;
 
 #ifdef MAEMO5
-		DrawTextWithOutline(data->font, al_map_rgb(255, 255, 255), al_map_rgb(99, 99, 99), 2, 2, ALLEGRO_ALIGN_LEFT, score);
+		DrawDigitsWithOutline(&data->digits, 2, 2, ALLEGRO_ALIGN_LEFT, score);
 	}
 	if (game->config.fullscreen) {
-		DrawTextWithOutline(data->font, al_map_rgb(255, 255, 255), al_map_rgb(99, 99, 99), 160 - 4, 2, ALLEGRO_ALIGN_RIGHT, "x");
+		DrawCachedTextWithOutline(&data->text, data->font, al_map_rgb(255, 255, 255), al_map_rgb(99, 99, 99), VIEWPORT_WIDTH - 4, 2, ALLEGRO_ALIGN_RIGHT, "x");
 	}
 #else
-		DrawTextWithOutline(data->font, al_map_rgb(255, 255, 255), al_map_rgb(99, 99, 99), 160 - 1, 2, ALLEGRO_ALIGN_RIGHT, score);
+		DrawDigitsWithOutline(&data->digits, VIEWPORT_WIDTH - 1, 2, ALLEGRO_ALIGN_RIGHT, score);
 	}
 #endif
 
-	if (data->throwing) {
-		al_draw_bitmap(data->corn, data->throwx, data->throwy, 0);
+	// Corns fly right by throw_speed pixels every tick, so there's no need to remember where they were before it.
+	// One thrown since the last tick hasn't moved yet and stays where it was thrown from.
+	for (int i = 0; i < BEACH_MAX_CORNS; i++) {
+		const struct BeachCorn* corn = &view->corns[i];
+		if (corn->active) {
+			float behind = fmin(corn->x - BEACH_CORN_X, view->throw_speed * (1 - alpha));
+			al_draw_bitmap(data->corn, Snap(corn->x - behind, detail), corn->y + scroll, 0);
+		}
 	}
 
-	if (data->started) {
-		al_draw_filled_rectangle(0, 85, 160, 90, al_map_rgba(0, 0, 0, 128));
+	if (view->started) {
+		al_hold_bitmap_drawing(false);
+		al_draw_filled_rectangle(0, VIEWPORT_HEIGHT - 5, VIEWPORT_WIDTH, VIEWPORT_HEIGHT, al_map_rgba(0, 0, 0, 128));
+		al_hold_bitmap_drawing(true);
 
-		if ((data->preparing) || (data->throwing)) {
+		if ((view->preparing) || (view->throwing)) {
 			al_draw_bitmap(data->pow, 0, 80, 0);
-			al_draw_bitmap(data->off, 5 * data->power, 80, 0);
+			al_draw_bitmap(data->off, 5 * view->power, 80, 0);
 		} else {
 			al_draw_bitmap(data->on, 0, 80, 0);
-			al_draw_bitmap(data->off, 5 * data->left, 80, 0);
+			al_draw_bitmap(data->off, 5 * view->left, 80, 0);
 		}
 
 	} else {
@@ -250,8 +429,26 @@ void Gamestate_Draw(struct Game* game, struct GamestateResources* data) {
 #else
 		char* tocorn = "Press SPACE to corn";
 #endif
-		DrawTextWithOutline(data->font, al_map_rgb(255, 255, 255), al_map_rgb(0, 0, 0), 160 / 2.0, 90 / 2.0 - 12, ALLEGRO_ALIGN_CENTER, "BOILED CORN");
-		DrawTextWithOutline(data->font, al_map_rgb(255, 255, 255), al_map_rgb(0, 0, 0), 160 / 2.0, 90 / 2.0 + 6, ALLEGRO_ALIGN_CENTER, tocorn);
+		DrawCachedTextWithOutline(&data->text, data->font, al_map_rgb(255, 255, 255), al_map_rgb(0, 0, 0), VIEWPORT_WIDTH / 2.0, VIEWPORT_HEIGHT / 2.0 - 12, ALLEGRO_ALIGN_CENTER, "BOILED CORN");
+		DrawCachedTextWithOutline(&data->text, data->font, al_map_rgb(255, 255, 255), al_map_rgb(0, 0, 0), VIEWPORT_WIDTH / 2.0, VIEWPORT_HEIGHT / 2.0 + 6, ALLEGRO_ALIGN_CENTER, tocorn);
+	}
+	al_hold_bitmap_drawing(false);
+
+	SetFramebufferAsTarget(game);
+	DrawUpscaled(game, data->screen);
+
+	struct Bench* bench = game->data->bench;
+	if (game->data->golden && data->scenario && bench->running && ((bench->drawn + 1) % GOLDEN_INTERVAL == 0)) {
+		char name[64];
+		snprintf(name, sizeof(name), "%s-%04d", data->scenario->name, bench->drawn + 1);
+		GoldenCheck(game->data->golden, name, data->screen);
+	}
+
+	if (game->data->startup_bench) {
+		// al_get_time() counts from Allegro's initialization
+		printf("time to first frame: %.1f ms (%d loader threads)\n", al_get_time() * 1000.0, game->data->loader_threads);
+		game->data->startup_bench = false;
+		QuitGame(game, false);
 	}
 }
 
@@ -277,121 +474,123 @@ void Gamestate_ProcessEvent(struct Game* game, struct GamestateResources* data,
 
 	if (((ev->type == ALLEGRO_EVENT_KEY_DOWN) && (ev->keyboard.keycode == ALLEGRO_KEY_SPACE)) ||
 		(ev->type == ALLEGRO_EVENT_TOUCH_BEGIN) || (ev->type == ALLEGRO_EVENT_JOYSTICK_BUTTON_DOWN)) {
-		if (!data->started) {
-			al_rewind_audio_stream(data->music);
-			al_set_audio_stream_playing(data->music, true);
-			data->started = true;
-			if (data->started_once) {
-				for (int i = 0; i < 6; i++) {
-					data->people[i].satisfied = true;
-					data->people[i].x = (rand() % 100) + 45;
-					data->people[i].y = 90 - 22 * i + (rand() % 5);
-					data->people[i].human = (rand() % 2) ? data->boy : data->girl;
-					data->people[i].towel = data->towels[rand() % 3];
-				}
-				data->people[0].x = 65;
-				data->people[5].x = 110;
-				data->people[4].satisfied = false;
-				data->people[5].satisfied = false;
-
-				al_set_target_bitmap(data->canvas);
-				al_clear_to_color(al_map_rgba(0, 0, 0, 0));
-				al_set_target_backbuffer(game->display);
-			}
-			data->started_once = true;
-			data->score = 0;
-			data->left = 32;
-			al_play_sample_instance(data->boiledcorn[rand() % 3]);
-			SelectSpritesheet(game, data->guy, "walk");
-		} else {
-			if (!data->throwing) {
-				data->preparing = true;
-				data->power = 0;
-			}
-		}
+		Press(game, data);
 	}
 
 	if (((ev->type == ALLEGRO_EVENT_KEY_UP) && (ev->keyboard.keycode == ALLEGRO_KEY_SPACE)) || (ev->type == ALLEGRO_EVENT_TOUCH_END) || (ev->type == ALLEGRO_EVENT_JOYSTICK_BUTTON_UP)) {
-		if (data->preparing) {
-			data->preparing = false;
-			data->throwing = true;
-			al_play_sample_instance(data->thr);
-			data->throwx = data->guy->x * 160 + 10;
-			data->throwy = (int)(data->guy->y * 90) + 5;
-			data->target = (int)(data->guy->x + 5 * data->power);
-		}
+		Release(game, data);
 	}
 }
 
 void* Gamestate_Load(struct Game* game, void (*progress)(struct Game*)) {
 	// Called once, when the gamestate library is being loaded.
 	// Good place for allocating memory, loading bitmaps etc.
+	double start = al_get_time();
 	struct GamestateResources* data = malloc(sizeof(struct GamestateResources));
 	al_set_new_bitmap_flags(al_get_new_bitmap_flags() ^ ALLEGRO_MAG_LINEAR);
+
+	// Decode all images and samples on worker threads while the rest gets loaded here.
+	struct AssetLoader loader;
+	InitAssetLoader(&loader, game);
+	LoadBitmapAsync(&loader, "boy.png", &data->boy);
+	LoadBitmapAsync(&loader, "cloud.png", &data->cloud);
+	LoadBitmapAsync(&loader, "girl.png", &data->girl);
+	LoadBitmapAsync(&loader, "lost.png", &data->lost);
+	LoadBitmapAsync(&loader, "off.png", &data->off);
+	LoadBitmapAsync(&loader, "on.png", &data->on);
+	LoadBitmapAsync(&loader, "power.png", &data->pow);
+	LoadBitmapAsync(&loader, "overlay.png", &data->overlay);
+	LoadBitmapAsync(&loader, "sand.png", &data->sand);
+	LoadBitmapAsync(&loader, "sea.png", &data->sea);
+	LoadBitmapAsync(&loader, "corn.png", &data->corn);
+	LoadBitmapAsync(&loader, "towel1.png", &data->towels[0]);
+	LoadBitmapAsync(&loader, "towel2.png", &data->towels[1]);
+	LoadBitmapAsync(&loader, "towel3.png", &data->towels[2]);
+	LoadSampleAsync(&loader, "point.flac", &data->win_sample);
+	LoadSampleAsync(&loader, "fail.flac", &data->lose_sample);
+	LoadSampleAsync(&loader, "throw.flac", &data->throw_sample);
+	StartAssetLoader(&loader, game->data->loader_threads);
+
 	data->font = al_create_builtin_font();
+	memset(&data->text, 0, sizeof(struct TextCache));
+	memset(&data->sim, 0, sizeof(struct BeachSim));
+	memset(&data->thread, 0, sizeof(struct SimThread));
+	data->threaded = game->data->sim_thread && !game->data->golden; // golden frames need ticks to be in step with frames
 	progress(game); // report that we progressed with the loading, so the engine can draw a progress bar
 
-	data->boy = al_load_bitmap(GetDataFilePath(game, "boy.png"));
-	data->cloud = al_load_bitmap(GetDataFilePath(game, "cloud.png"));
-	data->girl = al_load_bitmap(GetDataFilePath(game, "girl.png"));
-	data->lost = al_load_bitmap(GetDataFilePath(game, "lost.png"));
-	data->off = al_load_bitmap(GetDataFilePath(game, "off.png"));
-	data->on = al_load_bitmap(GetDataFilePath(game, "on.png"));
-	data->pow = al_load_bitmap(GetDataFilePath(game, "power.png"));
-	data->overlay = al_load_bitmap(GetDataFilePath(game, "overlay.png"));
-	data->sand = al_load_bitmap(GetDataFilePath(game, "sand.png"));
-	data->sea = al_load_bitmap(GetDataFilePath(game, "sea.png"));
-	data->corn = al_load_bitmap(GetDataFilePath(game, "corn.png"));
-	data->towels[0] = al_load_bitmap(GetDataFilePath(game, "towel1.png"));
-	data->towels[1] = al_load_bitmap(GetDataFilePath(game, "towel2.png"));
-	data->towels[2] = al_load_bitmap(GetDataFilePath(game, "towel3.png"));
-
-	data->tmp = CreateNotPreservedBitmap(160, 90);
-
 	data->guy = CreateCharacter(game, "guy");
 	RegisterSpritesheet(game, data->guy, "stand");
 	RegisterSpritesheet(game, data->guy, "walk");
 	LoadSpritesheets(game, data->guy, progress);
 
-	data->seanoise = al_load_audio_stream(GetDataFilePath(game, "sea.flac"), 4, 1024);
+	data->seanoise = LoadAudioStream(game, "sea.flac", 4, 1024);
 	al_attach_audio_stream_to_mixer(data->seanoise, game->audio.fx);
 	al_set_audio_stream_playmode(data->seanoise, ALLEGRO_PLAYMODE_LOOP);
 	al_set_audio_stream_playing(data->seanoise, false);
-	data->music = al_load_audio_stream(GetDataFilePath(game, "music.flac"), 4, 1024);
+	progress(game);
+
+	data->music = LoadAudioStream(game, "music.flac", 4, 1024);
 	al_attach_audio_stream_to_mixer(data->music, game->audio.music);
 	al_set_audio_stream_playmode(data->music, ALLEGRO_PLAYMODE_LOOP);
 	al_set_audio_stream_playing(data->music, false);
+	progress(game);
+
+	FinishAssetLoader(&loader, progress);
 
-	data->win_sample = al_load_sample(GetDataFilePath(game, "point.flac"));
 	data->win = al_create_sample_instance(data->win_sample);
 	al_attach_sample_instance_to_mixer(data->win, game->audio.fx);
 
-	data->lose_sample = al_load_sample(GetDataFilePath(game, "fail.flac"));
 	data->lose = al_create_sample_instance(data->lose_sample);
 	al_attach_sample_instance_to_mixer(data->lose, game->audio.fx);
 	al_set_sample_instance_gain(data->lose, 1.5);
 
-	data->throw_sample = al_load_sample(GetDataFilePath(game, "throw.flac"));
 	data->thr = al_create_sample_instance(data->throw_sample);
 	al_attach_sample_instance_to_mixer(data->thr, game->audio.fx);
 
-	data->corn_sample[0] = al_load_sample(GetDataFilePath(game, "corn1.flac"));
-	data->boiledcorn[0] = al_create_sample_instance(data->corn_sample[0]);
-	al_attach_sample_instance_to_mixer(data->boiledcorn[0], game->audio.voice);
+	ReportSampleMemory(game, "point.flac", data->win_sample);
+	ReportSampleMemory(game, "fail.flac", data->lose_sample);
+	ReportSampleMemory(game, "throw.flac", data->throw_sample);
 
-	data->corn_sample[1] = al_load_sample(GetDataFilePath(game, "corn2.flac"));
-	data->boiledcorn[1] = al_create_sample_instance(data->corn_sample[1]);
-	al_attach_sample_instance_to_mixer(data->boiledcorn[1], game->audio.voice);
-
-	data->corn_sample[2] = al_load_sample(GetDataFilePath(game, "corn3.flac"));
-	data->boiledcorn[2] = al_create_sample_instance(data->corn_sample[2]);
-	al_attach_sample_instance_to_mixer(data->boiledcorn[2], game->audio.voice);
+	// every clip gets a stream of its own; two may play at once, so that a new one can start before the previous has ended
+	InitVoicePool(&data->voices, game, 2, VOICE_BUFFERS, VOICE_BUFFER_SAMPLES);
+	data->boiledcorn[0] = AddVoiceClip(&data->voices, "corn1.flac", game->audio.voice);
+	data->boiledcorn[1] = AddVoiceClip(&data->voices, "corn2.flac", game->audio.voice);
+	data->boiledcorn[2] = AddVoiceClip(&data->voices, "corn3.flac", game->audio.voice);
+	progress(game);
 
+	ProfilerRecord(game->data->profiler, PROFILER_LOAD, start, al_get_time() - start);
 	return data;
 }
 
 void Gamestate_PostLoad(struct Game* game, struct GamestateResources* data) {
-	data->canvas = al_create_bitmap(160, 90);
+	// Upload decoded images as a single texture, once the loading thread is done. New bitmap flags are kept
+	// per thread, so the ones Gamestate_Load has set for the loading thread have to be set here again.
+	// Everything gets magnified when drawn onto the screen, so none of it is filtered.
+	ALLEGRO_STATE state;
+	al_store_state(&state, ALLEGRO_STATE_NEW_BITMAP_PARAMETERS);
+	al_set_new_bitmap_flags(al_get_new_bitmap_flags() & ~(ALLEGRO_MAG_LINEAR | ALLEGRO_MIN_LINEAR));
+	struct Atlas atlas = {0};
+	AtlasAdd(&atlas, data->boy, &data->boy);
+	AtlasAdd(&atlas, data->cloud, &data->cloud);
+	AtlasAdd(&atlas, data->girl, &data->girl);
+	AtlasAdd(&atlas, data->lost, &data->lost);
+	AtlasAdd(&atlas, data->off, &data->off);
+	AtlasAdd(&atlas, data->on, &data->on);
+	AtlasAdd(&atlas, data->pow, &data->pow);
+	AtlasAdd(&atlas, data->overlay, &data->overlay);
+	AtlasAdd(&atlas, data->sand, &data->sand);
+	AtlasAdd(&atlas, data->sea, &data->sea);
+	AtlasAdd(&atlas, data->corn, &data->corn);
+	AtlasAdd(&atlas, data->towels[0], &data->towels[0]);
+	AtlasAdd(&atlas, data->towels[1], &data->towels[1]);
+	AtlasAdd(&atlas, data->towels[2], &data->towels[2]);
+	data->atlas = AtlasBuild(&atlas);
+	data->canvas = al_create_bitmap(VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
+	InitLayerCache(&data->overlays, VIEWPORT_WIDTH, VIEWPORT_HEIGHT + 2);
+	al_restore_state(&state);
+	InitDigitStrip(&data->digits, data->font, al_map_rgb(255, 255, 255), al_map_rgb(99, 99, 99));
+	data->canvasy = 0;
+	data->screen = CreateLowResTarget(VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
 	al_set_target_bitmap(data->canvas);
 	al_clear_to_color(al_map_rgba(0, 0, 0, 0));
 	al_set_target_backbuffer(game->display);
@@ -400,6 +599,8 @@ void Gamestate_PostLoad(struct Game* game, struct GamestateResources* data) {
 void Gamestate_Unload(struct Game* game, struct GamestateResources* data) {
 	// Called when the gamestate library is being unloaded.
 	// Good place for freeing all allocated memory and resources.
+	ClearTextCache(&data->text);
+	DestroyDigitStrip(&data->digits);
 	al_destroy_font(data->font);
 	al_destroy_bitmap(data->boy);
 	al_destroy_bitmap(data->cloud);
@@ -415,9 +616,13 @@ void Gamestate_Unload(struct Game* game, struct GamestateResources* data) {
 	al_destroy_bitmap(data->towels[0]);
 	al_destroy_bitmap(data->towels[1]);
 	al_destroy_bitmap(data->towels[2]);
+	al_destroy_bitmap(data->atlas);
 	al_destroy_bitmap(data->canvas);
-	al_destroy_bitmap(data->tmp);
+	al_destroy_bitmap(data->screen);
+	DestroyLayerCache(&data->overlays);
 	DestroyCharacter(game, data->guy);
+	DestroySimThread(&data->thread);
+	BeachSimDestroy(&data->sim);
 	al_destroy_audio_stream(data->seanoise);
 	al_destroy_audio_stream(data->music);
 	al_destroy_sample_instance(data->win);
@@ -426,62 +631,36 @@ void Gamestate_Unload(struct Game* game, struct GamestateResources* data) {
 	al_destroy_sample(data->win_sample);
 	al_destroy_sample(data->lose_sample);
 	al_destroy_sample(data->throw_sample);
-	for (int i = 0; i < 3; i++) {
-		al_destroy_sample_instance(data->boiledcorn[i]);
-		al_destroy_sample(data->corn_sample[i]);
-	}
+	DestroyVoicePool(&data->voices);
 	free(data);
 }
 
 void Gamestate_Start(struct Game* game, struct GamestateResources* data) {
 	// Called when this gamestate gets control. Good place for initializing state,
 	// playing music etc.
-	data->counter = 0;
-	for (int i = 0; i < 6; i++) {
-		data->people[i].satisfied = true;
-		data->people[i].x = (rand() % 100) + 45;
-		data->people[i].y = 90 - 22 * i + (rand() % 5);
-		data->people[i].human = (rand() % 2) ? data->boy : data->girl;
-		data->people[i].towel = data->towels[rand() % 3];
-	}
-	data->people[0].x = 65;
-	data->people[5].x = 110;
-	data->people[4].satisfied = false;
-	data->people[5].satisfied = false;
-	data->power = 0;
-	data->left = 0;
-	data->preparing = false;
-	data->throwing = false;
-	data->throwx = 0;
-	data->seay = 0;
-	data->score = -1;
-	data->sandx = 0;
-	data->seax = 0;
-	data->maxsea = 0;
-	data->sandleft = 0;
-	data->seain = false;
-	data->started = false;
-	data->started_once = false;
-	SetCharacterPosition(game, data->guy, 27, 42, 0);
-	SelectSpritesheet(game, data->guy, "stand");
+	Reset(game, data);
 
-	al_play_sample_instance(data->boiledcorn[rand() % 3]);
+	FlushSimEvents(game, data);
 	al_set_audio_stream_playing(data->seanoise, true);
+	StartThread(game, data);
 }
 
 void Gamestate_Stop(struct Game* game, struct GamestateResources* data) {
 	// Called when gamestate gets stopped. Stop timers, music etc. here.
+	StopThread(game, data);
 }
 
 void Gamestate_Pause(struct Game* game, struct GamestateResources* data) {
 	// Called when gamestate gets paused (so only Draw is being called, no Logic not ProcessEvent)
 	// Pause your timers here.
+	StopThread(game, data);
 }
 
 void Gamestate_Resume(struct Game* game, struct GamestateResources* data) {
 	// Called when gamestate gets resumed. Resume your timers here.
+	StartThread(game, data);
 }
 
 void Gamestate_Reload(struct Game* game, struct GamestateResources* data) {
-	data->tmp = CreateNotPreservedBitmap(160, 90);
+	data->screen = CreateLowResTarget(VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
 }
@@ -18,22 +18,40 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "../bench.h"
 #include "../common.h"
+#include "../golden.h"
+#include "../loader.h"
+#include "../pixels.h"
+#include "../postprocess.h"
+#include "../profiler.h"
+#include "../upscale.h"
+#include "../voices.h"
 #include <libsuperderpy.h>
 #include <math.h>
 
 #define NEXT_GAMESTATE "beach"
 #define SKIP_GAMESTATE NEXT_GAMESTATE
 
+// The text is drawn at twice the native resolution, so that the font stays legible.
+#define INTRO_WIDTH (VIEWPORT_WIDTH * 2)
+#define INTRO_HEIGHT (VIEWPORT_HEIGHT * 2)
+
 struct GamestateResources {
 	ALLEGRO_FONT* font;
-	ALLEGRO_SAMPLE *sample, *kbd_sample, *key_sample;
-	ALLEGRO_SAMPLE_INSTANCE *sound, *kbd, *key;
-	ALLEGRO_BITMAP *bitmap, *checkerboard, *pixelator;
-	int pos;
+	ALLEGRO_SAMPLE* key_sample;
+	ALLEGRO_SAMPLE_INSTANCE* key;
+	struct VoicePool voices;
+	int sound, kbd;
+	ALLEGRO_BITMAP *bitmap, *checkerboard;
+	struct PostProcess post; // zooms, fades and pixelates the text layer onto the screen
+	int pos, typed;
 	double fade, tan;
-	char text[255];
+	double next_key; // time until the next character gets typed
+	char text[32]; // typed so far, followed by the cursor
 	bool underscore, fadeout;
+	double time; // since the start, for blinking the cursor
+	bool benchmarked; // by the intro benchmark scenario, which steps the intro by exactly one 60 Hz frame per frame
 	struct Timeline* timeline;
 };
 
@@ -41,6 +59,32 @@ int Gamestate_ProgressCount = 5;
 
 static const char* text = "# dosowisko.net";
 
+static const char* pixelator =
+	"#ifdef GL_ES\n"
+	"precision mediump float;\n"
+	"#endif\n"
+	"uniform sampler2D al_tex;\n"
+	"uniform float zoom;\n"
+	"uniform float fade;\n"
+	"uniform vec2 size;\n"
+	"uniform vec2 texture_scale;\n"
+	"uniform vec3 background;\n"
+	"varying vec2 varying_texcoord;\n"
+	"void main() {\n"
+	"  vec2 layer = varying_texcoord / texture_scale;\n" // from 0 to 1 over the layer, bottom up
+	"  vec2 pixel = floor(vec2(layer.x, 1.0 - layer.y) * size);\n" // counted from the top left, like the fallback does
+	"  vec2 uv = ((pixel + 0.5) / size + 0.05 * zoom) / (1.0 + 0.1 * zoom);\n"
+	"  vec4 color = vec4(0.0);\n"
+	"  if (uv.x >= 0.0 && uv.y >= 0.0 && uv.x <= 1.0 && uv.y <= 1.0) {\n"
+	"    color = texture2D(al_tex, vec2(uv.x, 1.0 - uv.y) * texture_scale) * fade;\n"
+	"  }\n"
+	"  vec3 result = color.rgb + background * (1.0 - color.a);\n"
+	"  if (mod(pixel.x, 2.0) < 1.0 && mod(pixel.y, 2.0) < 1.0) {\n"
+	"    result *= 1.0 - 64.0 / 255.0;\n"
+	"  }\n"
+	"  gl_FragColor = vec4(result, 1.0);\n"
+	"}\n";
+
 //==================================Timeline manager actions BEGIN
 static TM_ACTION(FadeIn) {
 	switch (action->state) {
@@ -77,60 +121,113 @@ static TM_ACTION(Play) {
 	return TM_END;
 }
 
-static TM_ACTION(Type) {
+static TM_ACTION(PlayKbd) {
 	TM_RunningOnly;
-	strncpy(data->text, text, data->pos++);
-	data->text[data->pos] = 0;
-	if (strcmp(data->text, text) != 0) {
-		TM_AddBackgroundAction(data->timeline, Type, NULL, (60 + rand() % 60) / 1000.0);
-	} else {
-		al_stop_sample_instance(data->kbd);
-	}
+	PlayVoiceClip(&data->voices, data->kbd);
 	return TM_END;
 }
+
+static void SetTyped(struct GamestateResources* data, int length) {
+	data->typed = length;
+	memcpy(data->text, text, length);
+	data->text[length] = data->underscore ? '_' : ' ';
+	data->text[length + 1] = 0;
+}
+
+static TM_ACTION(Type) {
+	// Keeps running until everything gets typed, instead of scheduling a new action for each character.
+	switch (action->state) {
+		case TM_ACTIONSTATE_START:
+			data->next_key = 0;
+			return TM_REPEAT;
+		case TM_ACTIONSTATE_RUNNING:
+			data->next_key -= action->delta;
+			if (data->next_key > 0) {
+				return TM_REPEAT;
+			}
+			SetTyped(data, data->pos++);
+			if (data->typed == (int)strlen(text)) {
+				StopVoiceClip(&data->voices, data->kbd);
+				return TM_END;
+			}
+			data->next_key += (60 + rand() % 60) / 1000.0;
+			return TM_REPEAT;
+		case TM_ACTIONSTATE_DESTROY:
+			return TM_END;
+		default:
+			return TM_REPEAT;
+	}
+}
 //==================================Timeline manager actions END
 
-void Gamestate_Logic(struct Game* game, struct GamestateResources* data, double delta) {
-	TM_Process(data->timeline, delta);
-	data->underscore = Fract(game->time) >= 0.5;
+static double GetZoom(struct GamestateResources* data) {
+	return tan(-data->tan / 384.0 * ALLEGRO_PI - ALLEGRO_PI / 2);
 }
 
-void Gamestate_Draw(struct Game* game, struct GamestateResources* data) {
-	if (!data->fadeout) {
-		char t[255] = "";
-		strncpy(t, data->text, 255);
-		if (data->underscore) {
-			strncat(t, "_", 2);
-		} else {
-			strncat(t, " ", 2);
-		}
+static void SetPixelatorUniforms(struct Game* game, ALLEGRO_BITMAP* source, void* d) {
+	struct GamestateResources* data = d;
+	float size[] = {al_get_bitmap_width(source), al_get_bitmap_height(source)};
+	float background[] = {35 / 255.0, 31 / 255.0, 32 / 255.0};
+	al_set_shader_float("zoom", GetZoom(data));
+	al_set_shader_float("fade", (int)data->fade / 255.0);
+	al_set_shader_float_vector("size", 2, size, 1);
+	al_set_shader_float_vector("background", 3, background, 1);
+}
 
-		al_set_target_bitmap(data->bitmap);
-		al_clear_to_color(al_map_rgba(0, 0, 0, 0));
+static void DrawPixelator(struct Game* game, ALLEGRO_BITMAP* source, void* d) {
+	// same as the shader above, in three passes
+	struct GamestateResources* data = d;
+	double tg = GetZoom(data);
+	int fade = (int)(data->fade);
 
-		al_draw_text(data->font, al_map_rgba(255, 255, 255, 10), 320 / 2.0,
-			180 * 0.4167, ALLEGRO_ALIGN_CENTRE, t);
+	al_clear_to_color(al_map_rgb(35, 31, 32));
 
-		double tg = tan(-data->tan / 384.0 * ALLEGRO_PI - ALLEGRO_PI / 2);
+	al_draw_tinted_scaled_bitmap(source, al_map_rgba(fade, fade, fade, fade), 0, 0,
+		al_get_bitmap_width(source), al_get_bitmap_height(source),
+		-tg * al_get_bitmap_width(source) * 0.05,
+		-tg * al_get_bitmap_height(source) * 0.05,
+		al_get_bitmap_width(source) + tg * 0.1 * al_get_bitmap_width(source),
+		al_get_bitmap_height(source) + tg * 0.1 * al_get_bitmap_height(source),
+		0);
 
-		int fade = data->fadeout ? 255 : (int)(data->fade);
+	al_draw_bitmap(data->checkerboard, 0, 0, 0);
+}
 
-		al_set_target_bitmap(data->pixelator);
-		al_clear_to_color(al_map_rgb(35, 31, 32));
+void Gamestate_Logic(struct Game* game, struct GamestateResources* data, double delta) {
+	if (data->benchmarked) {
+		struct Bench* bench = game->data->bench;
+		if (!bench->scenario || (strcmp(bench->scenario->gamestate, "dosowisko") != 0)) {
+			// done, move on to the beach's scenarios unless about to quit
+			data->benchmarked = false;
+			if (bench->scenario) {
+				SwitchCurrentGamestate(game, NEXT_GAMESTATE);
+			}
+			return;
+		}
+		delta = 1 / 60.0;
+	}
+	data->time += delta;
+	TM_Process(data->timeline, delta);
+	data->underscore = Fract(data->time) >= 0.5;
+	data->text[data->typed] = data->underscore ? '_' : ' ';
+}
 
-		al_draw_tinted_scaled_bitmap(data->bitmap, al_map_rgba(fade, fade, fade, fade), 0, 0,
-			al_get_bitmap_width(data->bitmap), al_get_bitmap_height(data->bitmap),
-			-tg * al_get_bitmap_width(data->bitmap) * 0.05,
-			-tg * al_get_bitmap_height(data->bitmap) * 0.05,
-			al_get_bitmap_width(data->bitmap) + tg * 0.1 * al_get_bitmap_width(data->bitmap),
-			al_get_bitmap_height(data->bitmap) + tg * 0.1 * al_get_bitmap_height(data->bitmap),
-			0);
+void Gamestate_Draw(struct Game* game, struct GamestateResources* data) {
+	if (!data->fadeout) {
+		al_set_target_bitmap(data->bitmap);
+		al_clear_to_color(al_map_rgba(0, 0, 0, 0));
 
-		al_draw_bitmap(data->checkerboard, 0, 0, 0);
+		al_draw_text(data->font, al_map_rgba(255, 255, 255, 10), INTRO_WIDTH / 2.0,
+			INTRO_HEIGHT * 0.4167, ALLEGRO_ALIGN_CENTRE, data->text);
 
-		SetFramebufferAsTarget(game);
+		DrawPostProcess(game, &data->post, data->bitmap);
 
-		al_draw_scaled_bitmap(data->pixelator, 0, 0, 320, 180, 0, 0, game->viewport.width, game->viewport.height, 0);
+		struct Bench* bench = game->data->bench;
+		if (game->data->golden && data->benchmarked && bench->running && ((bench->drawn + 1) % GOLDEN_INTERVAL == 0)) {
+			char name[64];
+			snprintf(name, sizeof(name), "%s-%04d", bench->scenario->name, bench->drawn + 1);
+			GoldenCheck(game->data->golden, name, data->post.buffer);
+		}
 	}
 }
 
@@ -140,19 +237,32 @@ void Gamestate_Start(struct Game* game, struct GamestateResources* data) {
 	data->tan = 64;
 	data->fadeout = false;
 	data->underscore = true;
-	strncpy(data->text, "#", 255);
-	TM_AddDelay(data->timeline, 0.3);
-	TM_AddQueuedBackgroundAction(data->timeline, FadeIn, NULL, 0);
-	TM_AddDelay(data->timeline, 1.5);
-	TM_AddNamedAction(data->timeline, Play, TM_Args(data->kbd), "PlayKbd");
-	TM_AddQueuedBackgroundAction(data->timeline, Type, NULL, 0);
+	data->time = 0;
+	SetTyped(data, 1);
+	// Background actions are added right away rather than queued, as the timeline allocates them when they're added.
+	TM_AddBackgroundAction(data->timeline, FadeIn, NULL, 0.3);
+	TM_AddBackgroundAction(data->timeline, Type, NULL, 1.8);
+	TM_AddDelay(data->timeline, 1.8);
+	TM_AddNamedAction(data->timeline, PlayKbd, NULL, "PlayKbd");
 	TM_AddDelay(data->timeline, 3.2);
 	TM_AddNamedAction(data->timeline, Play, TM_Args(data->key), "PlayKey");
 	TM_AddDelay(data->timeline, 0.05);
 	TM_AddAction(data->timeline, FadeOut, NULL);
 	TM_AddDelay(data->timeline, 1.0);
 	TM_AddAction(data->timeline, End, NULL);
-	al_play_sample_instance(data->sound);
+	PlayVoiceClip(&data->voices, data->sound);
+
+	struct Bench* bench = game->data->bench;
+	data->benchmarked = bench && bench->scenario && (strcmp(bench->scenario->gamestate, "dosowisko") == 0);
+	if (data->benchmarked) {
+		srand(BENCH_SEED); // typing speed is random
+		BenchStart(bench, game->data->profiler);
+	}
+	if (!bench) {
+		// Decode the beach while the intro plays, so that switching to it (or skipping to it) doesn't have to wait.
+		// Not while benchmarking, where it would count towards the intro's timings and allocations.
+		PrefetchGamestate(game, NEXT_GAMESTATE);
+	}
 }
 
 void Gamestate_ProcessEvent(struct Game* game, struct GamestateResources* data, ALLEGRO_EVENT* ev) {
@@ -163,84 +273,80 @@ void Gamestate_ProcessEvent(struct Game* game, struct GamestateResources* data,
 }
 
 void* Gamestate_Load(struct Game* game, void (*progress)(struct Game*)) {
+	double start = al_get_time();
 	struct GamestateResources* data = malloc(sizeof(struct GamestateResources));
 	int flags = al_get_new_bitmap_flags();
 	al_set_new_bitmap_flags(flags & ~ALLEGRO_MAG_LINEAR);
 
+	// Decode the sample on a worker thread while the font gets loaded here.
+	struct AssetLoader loader;
+	InitAssetLoader(&loader, game);
+	LoadSampleAsync(&loader, "key.flac", &data->key_sample);
+	StartAssetLoader(&loader, game->data->loader_threads);
+
 	data->timeline = TM_Init(game, data, "main");
-	data->bitmap = CreateNotPreservedBitmap(320, 180);
-	data->pixelator = CreateNotPreservedBitmap(320, 180);
-	data->checkerboard = al_create_bitmap(320, 180);
+	data->bitmap = CreateLowResTarget(INTRO_WIDTH, INTRO_HEIGHT);
+	data->checkerboard = al_create_bitmap(INTRO_WIDTH, INTRO_HEIGHT);
 	(*progress)(game);
 
-	data->font = al_load_ttf_font(GetDataFilePath(game, "fonts/DejaVuSansMono.ttf"),
-		(int)(180 * 0.1666 / 8) * 8, 0);
+	data->font = LoadTTFFont(game, "fonts/DejaVuSansMono.ttf",
+		(int)(INTRO_HEIGHT * 0.1666 / 8) * 8, 0);
 	(*progress)(game);
 
-	data->sample = al_load_sample(GetDataFilePath(game, "dosowisko.flac"));
-	data->sound = al_create_sample_instance(data->sample);
-	al_attach_sample_instance_to_mixer(data->sound, game->audio.music);
-	al_set_sample_instance_playmode(data->sound, ALLEGRO_PLAYMODE_ONCE);
-	(*progress)(game);
+	FinishAssetLoader(&loader, progress);
 
-	data->kbd_sample = al_load_sample(GetDataFilePath(game, "kbd.flac"));
-	data->kbd = al_create_sample_instance(data->kbd_sample);
-	al_attach_sample_instance_to_mixer(data->kbd, game->audio.fx);
-	al_set_sample_instance_playmode(data->kbd, ALLEGRO_PLAYMODE_ONCE);
+	InitVoicePool(&data->voices, game, 2, VOICE_BUFFERS, VOICE_BUFFER_SAMPLES);
+	data->sound = AddVoiceClip(&data->voices, "dosowisko.flac", game->audio.music);
+	data->kbd = AddVoiceClip(&data->voices, "kbd.flac", game->audio.fx);
 	(*progress)(game);
 
-	data->key_sample = al_load_sample(GetDataFilePath(game, "key.flac"));
 	data->key = al_create_sample_instance(data->key_sample);
 	al_attach_sample_instance_to_mixer(data->key, game->audio.fx);
 	al_set_sample_instance_playmode(data->key, ALLEGRO_PLAYMODE_ONCE);
+	ReportSampleMemory(game, "key.flac", data->key_sample);
 	(*progress)(game);
 
 	al_set_new_bitmap_flags(flags);
 
+	ProfilerRecord(game->data->profiler, PROFILER_LOAD, start, al_get_time() - start);
 	return data;
 }
 
 void Gamestate_PostLoad(struct Game* game, struct GamestateResources* data) {
-	al_set_target_bitmap(data->checkerboard);
-	al_lock_bitmap(data->checkerboard, ALLEGRO_PIXEL_FORMAT_ANY, ALLEGRO_LOCK_WRITEONLY);
-	int x, y;
-	for (x = 0; x < al_get_bitmap_width(data->checkerboard); x = x + 2) {
-		for (y = 0; y < al_get_bitmap_height(data->checkerboard); y = y + 2) {
-			al_put_pixel(x, y, al_map_rgba(0, 0, 0, 64));
-			al_put_pixel(x + 1, y, al_map_rgba(0, 0, 0, 0));
-			al_put_pixel(x, y + 1, al_map_rgba(0, 0, 0, 0));
-			al_put_pixel(x + 1, y + 1, al_map_rgba(0, 0, 0, 0));
-		}
-	}
-	al_unlock_bitmap(data->checkerboard);
+	const uint32_t tile[] = {
+		PackPixel(0, 0, 0, 64), PackPixel(0, 0, 0, 0),
+		PackPixel(0, 0, 0, 0), PackPixel(0, 0, 0, 0)};
+	FillBitmapPattern(data->checkerboard, tile, 2, 2);
+
+	// The font caches glyphs the first time they're drawn, which would otherwise happen while they're being typed.
+	al_set_target_bitmap(data->bitmap);
+	al_draw_text(data->font, al_map_rgb(0, 0, 0), 0, 0, ALLEGRO_ALIGN_LEFT, text);
+	al_draw_text(data->font, al_map_rgb(0, 0, 0), 0, 0, ALLEGRO_ALIGN_LEFT, "_");
 	al_set_target_backbuffer(game->display);
+
+	// Drivers compile and round shaders in their own ways, so golden frames are taken from the fallback,
+	// which draws into a buffer at the text layer's resolution before it gets upscaled.
+	InitPostProcess(game, &data->post, game->data->golden ? NULL : pixelator, INTRO_WIDTH, INTRO_HEIGHT, SetPixelatorUniforms, DrawPixelator, data);
 }
 
 void Gamestate_Stop(struct Game* game, struct GamestateResources* data) {
-	al_stop_sample_instance(data->sound);
-	al_stop_sample_instance(data->kbd);
+	StopVoiceClip(&data->voices, data->sound);
+	StopVoiceClip(&data->voices, data->kbd);
 	al_stop_sample_instance(data->key);
 }
 
 void Gamestate_Unload(struct Game* game, struct GamestateResources* data) {
 	al_destroy_font(data->font);
-	al_destroy_sample_instance(data->sound);
-	al_destroy_sample(data->sample);
-	al_destroy_sample_instance(data->kbd);
-	al_destroy_sample(data->kbd_sample);
+	DestroyVoicePool(&data->voices);
 	al_destroy_sample_instance(data->key);
 	al_destroy_sample(data->key_sample);
 	al_destroy_bitmap(data->bitmap);
 	al_destroy_bitmap(data->checkerboard);
-	al_destroy_bitmap(data->pixelator);
+	DestroyPostProcess(&data->post);
 	TM_Destroy(data->timeline);
 	free(data);
 }
 
 void Gamestate_Reload(struct Game* game, struct GamestateResources* data) {
-	int flags = al_get_new_bitmap_flags();
-	al_set_new_bitmap_flags(flags & ~ALLEGRO_MAG_LINEAR);
-	data->bitmap = CreateNotPreservedBitmap(320, 180);
-	data->pixelator = CreateNotPreservedBitmap(320, 180);
-	al_set_new_bitmap_flags(flags);
+	data->bitmap = CreateLowResTarget(INTRO_WIDTH, INTRO_HEIGHT);
 }
@@ -20,25 +20,34 @@
 
 #include "../common.h"
 #include <libsuperderpy.h>
+#include <math.h>
 
 /*! \brief Resources used by Loading state. */
 struct GamestateResources {
-	bool unused;
+	double progress; /*!< What the bar shows, eased towards the reported progress so it moves every frame. */
 };
 
 int Gamestate_ProgressCount = -1;
 
 void Gamestate_ProcessEvent(struct Game* game, struct GamestateResources* data, ALLEGRO_EVENT* ev){};
 
-void Gamestate_Logic(struct Game* game, struct GamestateResources* data, double delta){};
+void Gamestate_Logic(struct Game* game, struct GamestateResources* data, double delta) {
+	double target = game->loading.progress;
+	if (target < data->progress) {
+		// next gamestate started loading
+		data->progress = target;
+	} else {
+		data->progress += (target - data->progress) * fmin(delta * 12.0, 1.0);
+	}
+};
 
 void Gamestate_Draw(struct Game* game, struct GamestateResources* data) {
 	al_draw_filled_rectangle(0, game->viewport.height * 0.98, game->viewport.width, game->viewport.height, al_map_rgba(32, 32, 32, 32));
-	al_draw_filled_rectangle(0, game->viewport.height * 0.98, game->loading.progress * game->viewport.width, game->viewport.height, al_map_rgba(128, 128, 128, 128));
+	al_draw_filled_rectangle(0, game->viewport.height * 0.98, data->progress * game->viewport.width, game->viewport.height, al_map_rgba(128, 128, 128, 128));
 };
 
 void* Gamestate_Load(struct Game* game, void (*progress)(struct Game*)) {
-	struct GamestateResources* data = malloc(sizeof(struct GamestateResources));
+	struct GamestateResources* data = calloc(1, sizeof(struct GamestateResources));
 	return data;
 }
 
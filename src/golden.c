@@ -0,0 +1,132 @@
+/*! \file golden.c
+ *  \brief Comparing drawn frames against stored reference images.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "golden.h"
+#include "atlas.h"
+#include <stdio.h>
+
+struct Golden* CreateGolden(const char* dir, bool update) {
+	struct Golden* golden = calloc(1, sizeof(struct Golden));
+	golden->dir = strdup(dir);
+	golden->update = update;
+	return golden;
+}
+
+bool FinishGolden(struct Golden* golden) {
+	// Only prints and frees, as Allegro may already be shut down by now.
+	bool passed = !golden->failed && golden->checked;
+	if (!golden->checked) {
+		fprintf(stderr, "no golden frames were drawn\n");
+	} else if (golden->update) {
+		printf("%d golden frames written to %s\n", golden->checked, golden->dir);
+	} else {
+		printf("%d of %d golden frames matched\n", golden->checked - golden->failed, golden->checked);
+	}
+	free(golden->dir);
+	free(golden);
+	return passed;
+}
+
+static ALLEGRO_BITMAP* CopyToMemory(ALLEGRO_BITMAP* bitmap) {
+	int w = al_get_bitmap_width(bitmap), h = al_get_bitmap_height(bitmap);
+	ALLEGRO_STATE state;
+	al_store_state(&state, ALLEGRO_STATE_NEW_BITMAP_PARAMETERS);
+	al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+	al_set_new_bitmap_format(ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE);
+	ALLEGRO_BITMAP* copy = al_create_bitmap(w, h);
+	al_restore_state(&state);
+
+	ALLEGRO_LOCKED_REGION* src = al_lock_bitmap(bitmap, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_READONLY);
+	ALLEGRO_LOCKED_REGION* dst = al_lock_bitmap(copy, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_WRITEONLY);
+	for (int y = 0; y < h; y++) {
+		memcpy((char*)dst->data + y * dst->pitch, (char*)src->data + y * src->pitch, w * 4);
+	}
+	al_unlock_bitmap(copy);
+	al_unlock_bitmap(bitmap);
+	return copy;
+}
+
+static int Compare(ALLEGRO_BITMAP* actual, ALLEGRO_BITMAP* expected, int* max) {
+	// Returns the number of pixels which differ by more than GOLDEN_TOLERANCE in any channel.
+	int w = al_get_bitmap_width(actual), h = al_get_bitmap_height(actual);
+	if ((w != al_get_bitmap_width(expected)) || (h != al_get_bitmap_height(expected))) {
+		*max = 255;
+		return w * h;
+	}
+	ALLEGRO_LOCKED_REGION* a = al_lock_bitmap(actual, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_READONLY);
+	ALLEGRO_LOCKED_REGION* e = al_lock_bitmap(expected, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_READONLY);
+	int differing = 0;
+	*max = 0;
+	for (int y = 0; y < h; y++) {
+		const unsigned char* pa = (const unsigned char*)a->data + y * a->pitch;
+		const unsigned char* pe = (const unsigned char*)e->data + y * e->pitch;
+		for (int x = 0; x < w; x++) {
+			int diff = 0;
+			for (int c = 0; c < 4; c++) {
+				int d = abs(pa[x * 4 + c] - pe[x * 4 + c]);
+				if (d > diff) {
+					diff = d;
+				}
+			}
+			if (diff > *max) {
+				*max = diff;
+			}
+			differing += diff > GOLDEN_TOLERANCE;
+		}
+	}
+	al_unlock_bitmap(expected);
+	al_unlock_bitmap(actual);
+	return differing;
+}
+
+void GoldenCheck(struct Golden* golden, const char* name, ALLEGRO_BITMAP* frame) {
+	char path[1024];
+	snprintf(path, sizeof(path), "%s/%s.png", golden->dir, name);
+	ALLEGRO_BITMAP* actual = CopyToMemory(frame);
+	golden->checked++;
+
+	if (golden->update) {
+		if (!al_save_bitmap(path, actual)) {
+			fprintf(stderr, "%s: cannot be written\n", path);
+			golden->failed++;
+		}
+		al_destroy_bitmap(actual);
+		return;
+	}
+
+	ALLEGRO_BITMAP* expected = LoadMemoryBitmap(path);
+	if (!expected) {
+		fprintf(stderr, "%s: missing\n", path);
+		golden->failed++;
+		al_destroy_bitmap(actual);
+		return;
+	}
+	int max;
+	int differing = Compare(actual, expected, &max);
+	if (differing) {
+		// keep what got drawn next to the reference, to be looked at or promoted with --golden-update
+		snprintf(path, sizeof(path), "%s/%s.actual.png", golden->dir, name);
+		al_save_bitmap(path, actual);
+		fprintf(stderr, "%s: %d pixels differ by up to %d, see %s\n", name, differing, max, path);
+		golden->failed++;
+	}
+	al_destroy_bitmap(expected);
+	al_destroy_bitmap(actual);
+}
@@ -0,0 +1,41 @@
+/*! \file golden.h
+ *  \brief Comparing drawn frames against stored reference images.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GOLDEN_H
+#define GOLDEN_H
+
+#include "common.h"
+
+#define GOLDEN_INTERVAL 100 // frames between checks
+#define GOLDEN_TOLERANCE 2 // per channel, as drivers don't all round blending the same way
+
+/*! \brief Checks frames against PNG files in a directory, or writes them there when updating. */
+struct Golden {
+	char* dir;
+	bool update;
+	int checked;
+	int failed;
+};
+
+struct Golden* CreateGolden(const char* dir, bool update);
+bool FinishGolden(struct Golden* golden);
+void GoldenCheck(struct Golden* golden, const char* name, ALLEGRO_BITMAP* frame);
+
+#endif
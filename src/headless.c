@@ -0,0 +1,255 @@
+/*! \file headless.c
+ *  \brief Display-less runner for the beach simulation.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "headless.h"
+#include "beachsim.h"
+#include "replay.h"
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static void Press(struct BeachSim* sim, struct ReplayWriter* recorder) {
+	if (recorder) {
+		ReplayWrite(recorder, sim->frames, REPLAY_PRESS, 0);
+	}
+	BeachSimPress(sim);
+}
+
+static void Release(struct BeachSim* sim, struct ReplayWriter* recorder) {
+	if (recorder) {
+		ReplayWrite(recorder, sim->frames, REPLAY_RELEASE, 0);
+	}
+	BeachSimRelease(sim);
+}
+
+static void Autoplay(struct BeachAutoplayer* player, struct BeachSim* sim, struct ReplayWriter* recorder) {
+	unsigned int input = BeachAutoplay(player, sim);
+	if (input & BEACH_INPUT_PRESS) {
+		Press(sim, recorder);
+	}
+	if (input & BEACH_INPUT_RELEASE) {
+		Release(sim, recorder);
+	}
+}
+
+static double GetSeconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+bool IsHeadless(int argc, char** argv) {
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--headless") == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static int VerifyReplays(int count, char** paths) {
+	int failed = 0;
+	double start = GetSeconds();
+	for (int i = 0; i < count; i++) {
+		struct Replay* replay = ReplayOpen(paths[i]);
+		if (!replay) {
+			printf("%s: cannot read replay\n", paths[i]);
+			failed++;
+			continue;
+		}
+		struct ReplayResult result = ReplayVerify(replay);
+		if (result.ok) {
+			printf("%s: ok, %u ticks, score %d\n", paths[i], result.ticks, result.score);
+		} else {
+			printf("%s: diverged at tick %u (record %lld)\n", paths[i], result.diverged_tick, (long long)result.diverged);
+			failed++;
+		}
+		ReplayClose(replay);
+	}
+	printf("%d of %d replays verified in %.3f s\n", count - failed, count, GetSeconds() - start);
+	return failed ? 1 : 0;
+}
+
+static int RunCrowdBench(uint64_t seed, long long ticks, int people, bool rapid_fire) {
+	// Every crowd size unless one was given. Fails if the grid index ever disagrees with scanning everyone.
+	static const int counts[] = {6, 60, 600, 6000, 60000, BEACH_MAX_PEOPLE};
+	int failed = 0;
+	for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+		int count = people ? people : counts[c];
+		struct BeachSim sim;
+		struct BeachAutoplayer player;
+		BeachSimInit(&sim, seed, count);
+		sim.rapid_fire = rapid_fire;
+		BeachAutoplayerInit(&player, ~seed, 32);
+
+		double start = GetSeconds();
+		for (long long tick = 0; tick < ticks; tick++) {
+			Autoplay(&player, &sim, NULL);
+			BeachSimTick(&sim);
+			sim.events = 0;
+		}
+		double elapsed = GetSeconds() - start;
+
+		// hit test every point of the screen, with the grid index and by scanning everyone
+		static int found[BEACH_HEIGHT][BEACH_WIDTH];
+		double indexed = GetSeconds();
+		for (int y = 0; y < BEACH_HEIGHT; y++) {
+			for (int x = 0; x < BEACH_WIDTH; x++) {
+				found[y][x] = BeachSimFindTowel(&sim, x, y);
+			}
+		}
+		indexed = GetSeconds() - indexed;
+		int mismatches = 0;
+		double scanned = GetSeconds();
+		for (int y = 0; y < BEACH_HEIGHT; y++) {
+			for (int x = 0; x < BEACH_WIDTH; x++) {
+				mismatches += BeachSimFindTowelSlow(&sim, x, y) != found[y][x];
+			}
+		}
+		scanned = GetSeconds() - scanned;
+
+		int tests = BEACH_WIDTH * BEACH_HEIGHT;
+		printf("%6d people: %12.0f ticks per second, %10.0f hit tests per second (%.0f by scanning)%s\n", count,
+			elapsed > 0 ? ticks / elapsed : 0.0, indexed > 0 ? tests / indexed : 0.0, scanned > 0 ? tests / scanned : 0.0,
+			mismatches ? ", MISMATCHED" : "");
+		failed += mismatches != 0;
+		BeachSimDestroy(&sim);
+		if (people) {
+			break;
+		}
+	}
+	return failed ? 1 : 0;
+}
+
+static int RunSeaCheck(long long ticks) {
+	// compare the sea's phase and wave table against the floating point formula they replaced
+	uint64_t phase = 0;
+	long long mismatches = 0;
+	for (long long frame = 1; frame <= ticks; frame++) {
+		phase += BEACH_SEA_PHASE_STEP;
+		if (phase >= BEACH_SEA_PHASE_PI) {
+			phase -= BEACH_SEA_PHASE_PI;
+		}
+		int expected = (int)(fabs(sin(frame / 64.0)) * 16);
+		int wave = BeachSeaWave(phase);
+		if (wave != expected) {
+			if (!mismatches) {
+				printf("frame %lld: wave %d, expected %d\n", frame, wave, expected);
+			}
+			mismatches++;
+		}
+	}
+	printf("sea waves: %lld frames checked, %lld mismatched\n", ticks, mismatches);
+	return mismatches ? 1 : 0;
+}
+
+int RunHeadless(int argc, char** argv) {
+	uint64_t seed = (uint64_t)time(NULL);
+	long long ticks = -1;
+	int people = 0; // BEACH_PEOPLE, or every size for --crowd-bench
+	bool crowd_bench = false, sea_check = false, rapid_fire = false;
+	const char* record = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "--seed") == 0) && (i + 1 < argc)) {
+			seed = strtoull(argv[++i], NULL, 10);
+		} else if ((strcmp(argv[i], "--ticks") == 0) && (i + 1 < argc)) {
+			ticks = strtoll(argv[++i], NULL, 10);
+		} else if ((strcmp(argv[i], "--people") == 0) && (i + 1 < argc)) {
+			people = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--rapid-fire") == 0) {
+			rapid_fire = true;
+		} else if (strcmp(argv[i], "--crowd-bench") == 0) {
+			crowd_bench = true;
+		} else if (strcmp(argv[i], "--sea-check") == 0) {
+			sea_check = true;
+		} else if ((strcmp(argv[i], "--record") == 0) && (i + 1 < argc)) {
+			record = argv[++i];
+		} else if (strcmp(argv[i], "--replay") == 0) {
+			// all remaining arguments are replay files
+			return VerifyReplays(argc - i - 1, argv + i + 1);
+		}
+	}
+
+	if (sea_check) {
+		return RunSeaCheck((ticks < 0) ? 60 * 60 * 60 * 24 : ticks);
+	}
+	if (crowd_bench) {
+		return RunCrowdBench(seed, (ticks < 0) ? 60 * 60 : ticks, people, rapid_fire);
+	}
+	if (!people) {
+		people = BEACH_PEOPLE;
+	}
+	if (ticks < 0) {
+		ticks = 60 * 60 * 60;
+	}
+
+	struct ReplayWriter* recorder = NULL;
+	if (record) {
+		recorder = ReplayWriterOpen(record);
+		if (!recorder) {
+			fprintf(stderr, "Cannot open %s for writing\n", record);
+			return 1;
+		}
+		ReplayWrite(recorder, 0, REPLAY_PEOPLE, people);
+		if (rapid_fire) {
+			ReplayWrite(recorder, 0, REPLAY_RAPID_FIRE, 1);
+		}
+		ReplayWrite(recorder, 0, REPLAY_SEED, seed);
+	}
+
+	struct BeachSim sim;
+	struct BeachAutoplayer player;
+	BeachSimInit(&sim, seed, people);
+	sim.rapid_fire = rapid_fire;
+	BeachAutoplayerInit(&player, ~seed, 32);
+
+	long long sessions = 0, score = 0;
+	double start = GetSeconds();
+	for (long long tick = 0; tick < ticks; tick++) {
+		Autoplay(&player, &sim, recorder);
+		BeachSimTick(&sim);
+		if (recorder) {
+			ReplayWrite(recorder, sim.frames, REPLAY_HASH, BeachSimHash(&sim));
+		}
+		if (sim.events & BEACH_EVENT_END) {
+			sessions++;
+			score += sim.score;
+		}
+		sim.events = 0;
+	}
+	double elapsed = GetSeconds() - start;
+
+	if (recorder) {
+		ReplayWriterClose(recorder);
+	}
+
+	printf("seed: %" PRIu64 "\n", seed);
+	printf("ticks: %lld\n", ticks);
+	printf("sessions: %lld\n", sessions);
+	printf("average score: %.3f\n", sessions ? score / (double)sessions : 0.0);
+	printf("final score: %d\n", sim.score);
+	printf("ticks per second: %.0f\n", elapsed > 0 ? ticks / elapsed : 0.0);
+	BeachSimDestroy(&sim);
+	return 0;
+}
@@ -0,0 +1,53 @@
+/*! \file layercache.c
+ *  \brief Caching of layers which only change along with a few parameters.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "layercache.h"
+
+void InitLayerCache(struct LayerCache* cache, int width, int height) {
+	memset(cache, 0, sizeof(struct LayerCache));
+	cache->bitmap = al_create_bitmap(width, height);
+}
+
+ALLEGRO_BITMAP* UpdateLayerCache(struct Game* game, struct LayerCache* cache, const int* params, int count, LayerCacheFunc* draw, void* data) {
+	if (count > LAYER_CACHE_MAX_PARAMS) {
+		count = LAYER_CACHE_MAX_PARAMS;
+	}
+	if (cache->valid && cache->count == count && memcmp(cache->params, params, count * sizeof(int)) == 0) {
+		return cache->bitmap;
+	}
+	memcpy(cache->params, params, count * sizeof(int));
+	cache->count = count;
+	cache->valid = true;
+
+	ALLEGRO_STATE state;
+	al_store_state(&state, ALLEGRO_STATE_TARGET_BITMAP);
+	al_set_target_bitmap(cache->bitmap);
+	draw(game, data);
+	al_restore_state(&state);
+	return cache->bitmap;
+}
+
+void InvalidateLayerCache(struct LayerCache* cache) {
+	cache->valid = false;
+}
+
+void DestroyLayerCache(struct LayerCache* cache) {
+	al_destroy_bitmap(cache->bitmap);
+}
@@ -0,0 +1,43 @@
+/*! \file layercache.h
+ *  \brief Caching of layers which only change along with a few parameters.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LAYERCACHE_H
+#define LAYERCACHE_H
+
+#include "common.h"
+
+#define LAYER_CACHE_MAX_PARAMS 8
+
+typedef void LayerCacheFunc(struct Game* game, void* data);
+
+/*! \brief Offscreen bitmap holding a composited layer, redrawn only when the parameters it depends on change. */
+struct LayerCache {
+	ALLEGRO_BITMAP* bitmap;
+	int params[LAYER_CACHE_MAX_PARAMS];
+	int count;
+	bool valid;
+};
+
+void InitLayerCache(struct LayerCache* cache, int width, int height);
+ALLEGRO_BITMAP* UpdateLayerCache(struct Game* game, struct LayerCache* cache, const int* params, int count, LayerCacheFunc* draw, void* data);
+void InvalidateLayerCache(struct LayerCache* cache);
+void DestroyLayerCache(struct LayerCache* cache);
+
+#endif
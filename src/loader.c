@@ -0,0 +1,303 @@
+/*! \file loader.c
+ *  \brief Parallel decoding of assets.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "loader.h"
+#include "assetpack.h"
+#include "atlas.h"
+#include "manifest.h"
+
+void InitAssetLoader(struct AssetLoader* loader, struct Game* game) {
+	memset(loader, 0, sizeof(struct AssetLoader));
+	loader->game = game;
+	// File interface is a thread-local setting, so workers have to inherit it (e.g. to read from the APK on Android).
+	loader->file_interface = al_get_new_file_interface();
+}
+
+static void DestroyAsset(enum AssetType type, void* asset) {
+	if (!asset) {
+		return;
+	}
+	switch (type) {
+		case ASSET_BITMAP:
+			al_destroy_bitmap(asset);
+			break;
+		case ASSET_SAMPLE:
+			al_destroy_sample(asset);
+			break;
+	}
+}
+
+void DestroyPrefetch(struct Prefetch* prefetch) {
+	if (!prefetch->finished) {
+		FinishAssetLoader(&prefetch->loader, NULL);
+	}
+	for (int i = 0; i < prefetch->count; i++) {
+		if (prefetch->names[i]) {
+			DestroyAsset(prefetch->types[i], prefetch->assets[i]);
+		}
+	}
+	free(prefetch);
+}
+
+static bool Claim(struct Game* game, enum AssetType type, const char* name, void** out) {
+	struct Prefetch* prefetch = game->data->prefetch;
+	if (!prefetch) {
+		return false;
+	}
+	int remaining = 0, found = -1;
+	for (int i = 0; i < prefetch->count; i++) {
+		if (prefetch->names[i] && (found == -1) && (prefetch->types[i] == type) && (strcmp(prefetch->names[i], name) == 0)) {
+			found = i;
+		} else if (prefetch->names[i]) {
+			remaining++;
+		}
+	}
+	if (found == -1) {
+		return false;
+	}
+	if (!prefetch->finished) {
+		// waits for whatever is still being decoded
+		FinishAssetLoader(&prefetch->loader, NULL);
+		prefetch->finished = true;
+	}
+	*out = prefetch->assets[found];
+	prefetch->names[found] = NULL;
+	if (!remaining) {
+		DestroyPrefetch(prefetch);
+		game->data->prefetch = NULL;
+	}
+	return true;
+}
+
+static void Queue(struct AssetLoader* loader, enum AssetType type, const char* name, void** out) {
+	*out = NULL;
+	if (Claim(loader->game, type, name, out) || (loader->count == LOADER_MAX_JOBS)) {
+		loader->skipped++;
+		return;
+	}
+	struct AssetJob* job = &loader->jobs[loader->count];
+	job->type = type;
+	job->entry = FindPackedAsset(loader->game->data->pack, name);
+	if (job->entry && job->entry->type != ((type == ASSET_BITMAP) ? ASSETPACK_BITMAP : ASSETPACK_SAMPLE)) {
+		job->entry = NULL;
+	}
+	// paths are resolved here, as GetDataFilePath isn't meant to be called from other threads
+	job->path = job->entry ? NULL : strdup(GetDataFilePath(loader->game, name));
+	job->out = out;
+	loader->count++;
+}
+
+void LoadBitmapAsync(struct AssetLoader* loader, const char* name, ALLEGRO_BITMAP** out) {
+	Queue(loader, ASSET_BITMAP, name, (void**)out);
+}
+
+void LoadSampleAsync(struct AssetLoader* loader, const char* name, ALLEGRO_SAMPLE** out) {
+	Queue(loader, ASSET_SAMPLE, name, (void**)out);
+}
+
+static ALLEGRO_BITMAP* CreatePackedBitmap(const struct AssetPack* pack, const struct AssetPackEntry* entry) {
+	int w = entry->params[0], h = entry->params[1];
+	ALLEGRO_STATE state;
+	al_store_state(&state, ALLEGRO_STATE_NEW_BITMAP_PARAMETERS);
+	al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+	al_set_new_bitmap_format(ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE);
+	ALLEGRO_BITMAP* bitmap = al_create_bitmap(w, h);
+	al_restore_state(&state);
+	if (!bitmap) {
+		return NULL;
+	}
+	const char* pixels = GetPackedAssetData(pack, entry);
+	ALLEGRO_LOCKED_REGION* region = al_lock_bitmap(bitmap, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_WRITEONLY);
+	for (int y = 0; y < h; y++) {
+		memcpy((char*)region->data + y * region->pitch, pixels + y * w * 4, w * 4);
+	}
+	al_unlock_bitmap(bitmap);
+	return bitmap;
+}
+
+static ALLEGRO_SAMPLE* CreatePackedSample(const struct AssetPack* pack, const struct AssetPackEntry* entry) {
+	// The sample doesn't own its buffer, so the PCM data stays in the mapping and is never copied.
+	return al_create_sample((void*)GetPackedAssetData(pack, entry), entry->params[0], entry->params[1],
+		entry->params[2], entry->params[3], false);
+}
+
+static void Decode(struct AssetLoader* loader, struct AssetJob* job) {
+	struct AssetPack* pack = loader->game->data->pack;
+	switch (job->type) {
+		case ASSET_BITMAP:
+			*job->out = job->entry ? CreatePackedBitmap(pack, job->entry) : LoadMemoryBitmap(job->path);
+			break;
+		case ASSET_SAMPLE:
+			*job->out = job->entry ? CreatePackedSample(pack, job->entry) : al_load_sample(job->path);
+			break;
+	}
+	free(job->path);
+}
+
+static struct AssetJob* NextJob(struct AssetLoader* loader) {
+	struct AssetJob* job = NULL;
+	al_lock_mutex(loader->mutex);
+	if (loader->next < loader->count) {
+		job = &loader->jobs[loader->next++];
+	}
+	al_unlock_mutex(loader->mutex);
+	return job;
+}
+
+static void* Worker(ALLEGRO_THREAD* thread, void* arg) {
+	struct AssetLoader* loader = arg;
+	al_set_new_file_interface(loader->file_interface);
+	struct AssetJob* job;
+	while ((job = NextJob(loader))) {
+		Decode(loader, job);
+		al_lock_mutex(loader->mutex);
+		loader->done++;
+		al_broadcast_cond(loader->cond);
+		al_unlock_mutex(loader->mutex);
+	}
+	return NULL;
+}
+
+void StartAssetLoader(struct AssetLoader* loader, int threads) {
+	// With threads <= 0, everything gets decoded sequentially in FinishAssetLoader.
+	if (threads > LOADER_MAX_THREADS) {
+		threads = LOADER_MAX_THREADS;
+	}
+	if (threads > loader->count) {
+		threads = loader->count;
+	}
+	if (threads <= 0) {
+		return;
+	}
+	loader->mutex = al_create_mutex();
+	loader->cond = al_create_cond();
+	for (int i = 0; i < threads; i++) {
+		loader->threads[i] = al_create_thread(Worker, loader);
+		if (!loader->threads[i]) {
+			break;
+		}
+		al_start_thread(loader->threads[i]);
+		loader->nthreads++;
+	}
+}
+
+static void ReportProgress(struct Game* game, void (*progress)(struct Game*), int steps) {
+	if (!progress) {
+		return;
+	}
+	for (int i = 0; i < steps; i++) {
+		progress(game);
+	}
+}
+
+void FinishAssetLoader(struct AssetLoader* loader, void (*progress)(struct Game*)) {
+	// Every queued asset is one progress step, reported as soon as it's ready rather than all at once at the end,
+	// so the loading screen keeps moving while the workers are busy. This is only reporting: the work itself isn't
+	// split up any further, so a single large asset still blocks its step until it's decoded.
+	ReportProgress(loader->game, progress, loader->skipped);
+	if (progress && loader->nthreads) {
+		int reported = 0;
+		al_lock_mutex(loader->mutex);
+		while (reported < loader->count) {
+			while (loader->done == reported) {
+				al_wait_cond(loader->cond, loader->mutex);
+			}
+			int done = loader->done;
+			al_unlock_mutex(loader->mutex);
+			ReportProgress(loader->game, progress, done - reported);
+			reported = done;
+			al_lock_mutex(loader->mutex);
+		}
+		al_unlock_mutex(loader->mutex);
+	}
+	for (int i = 0; i < loader->nthreads; i++) {
+		al_join_thread(loader->threads[i], NULL);
+		al_destroy_thread(loader->threads[i]);
+	}
+	if (loader->mutex) {
+		al_destroy_mutex(loader->mutex);
+		al_destroy_cond(loader->cond);
+	}
+	// whatever hasn't been picked up by workers (if any) gets decoded here, one asset per step
+	for (int i = loader->next; i < loader->count; i++) {
+		Decode(loader, &loader->jobs[i]);
+		ReportProgress(loader->game, progress, 1);
+	}
+	loader->nthreads = 0;
+	loader->mutex = NULL;
+	loader->cond = NULL;
+	loader->next = loader->count = loader->done = loader->skipped = 0;
+}
+
+void PrefetchGamestate(struct Game* game, const char* name) {
+	// Only memory bitmaps and samples are decoded here, so that nothing touches the GPU from the workers.
+	const struct AssetManifest* manifest = FindAssetManifest(name);
+	if (!manifest || game->data->prefetch) {
+		return;
+	}
+	struct Prefetch* prefetch = calloc(1, sizeof(struct Prefetch));
+	InitAssetLoader(&prefetch->loader, game);
+	for (const char* const* asset = manifest->bitmaps; *asset && prefetch->count < LOADER_MAX_JOBS; asset++) {
+		prefetch->names[prefetch->count] = *asset;
+		prefetch->types[prefetch->count] = ASSET_BITMAP;
+		LoadBitmapAsync(&prefetch->loader, *asset, (ALLEGRO_BITMAP**)&prefetch->assets[prefetch->count++]);
+	}
+	for (const char* const* asset = manifest->samples; *asset && prefetch->count < LOADER_MAX_JOBS; asset++) {
+		prefetch->names[prefetch->count] = *asset;
+		prefetch->types[prefetch->count] = ASSET_SAMPLE;
+		LoadSampleAsync(&prefetch->loader, *asset, (ALLEGRO_SAMPLE**)&prefetch->assets[prefetch->count++]);
+	}
+	StartAssetLoader(&prefetch->loader, game->data->loader_threads);
+	game->data->prefetch = prefetch;
+}
+
+ALLEGRO_FILE* OpenDataFile(struct Game* game, const char* name) {
+	const struct AssetPackEntry* entry = FindPackedAsset(game->data->pack, name);
+	if (entry && entry->type == ASSETPACK_FILE) {
+		return al_open_memfile((void*)GetPackedAssetData(game->data->pack, entry), entry->size, "r");
+	}
+	return al_fopen(GetDataFilePath(game, name), "rb");
+}
+
+ALLEGRO_AUDIO_STREAM* LoadAudioStream(struct Game* game, const char* name, size_t buffers, unsigned int samples) {
+	ALLEGRO_FILE* file = OpenDataFile(game, name);
+	if (!file) {
+		return NULL;
+	}
+	// the stream takes ownership of the file
+	ALLEGRO_AUDIO_STREAM* stream = al_load_audio_stream_f(file, strrchr(name, '.'), buffers, samples);
+	if (!stream) {
+		al_fclose(file);
+	}
+	return stream;
+}
+
+ALLEGRO_FONT* LoadTTFFont(struct Game* game, const char* name, int size, int flags) {
+	ALLEGRO_FILE* file = OpenDataFile(game, name);
+	if (!file) {
+		return NULL;
+	}
+	// the font takes ownership of the file
+	ALLEGRO_FONT* font = al_load_ttf_font_f(file, name, size, flags);
+	if (!font) {
+		al_fclose(file);
+	}
+	return font;
+}
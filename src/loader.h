@@ -0,0 +1,79 @@
+/*! \file loader.h
+ *  \brief Parallel decoding of assets.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LOADER_H
+#define LOADER_H
+
+#include "common.h"
+
+#define LOADER_MAX_JOBS 32
+#define LOADER_MAX_THREADS 8
+
+enum AssetType {
+	ASSET_BITMAP, /*!< Decoded into a memory bitmap, to be uploaded by the caller. */
+	ASSET_SAMPLE, /*!< Points straight into the asset pack when it's available. */
+};
+
+struct AssetJob {
+	enum AssetType type;
+	const struct AssetPackEntry* entry; /*!< If set, the asset gets created from the pack instead of decoded from `path`. */
+	char* path;
+	void** out;
+};
+
+/*! \brief Decodes queued files on a pool of worker threads. */
+struct AssetLoader {
+	struct AssetJob jobs[LOADER_MAX_JOBS];
+	int count;
+	int next;
+	int done; /*!< Number of jobs decoded so far, guarded by `mutex`. */
+	int skipped; /*!< Assets queued without a job, as they were claimed from a prefetch or didn't fit. */
+	ALLEGRO_MUTEX* mutex;
+	ALLEGRO_COND* cond;
+	ALLEGRO_THREAD* threads[LOADER_MAX_THREADS];
+	int nthreads;
+	const ALLEGRO_FILE_INTERFACE* file_interface;
+	struct Game* game;
+};
+
+/*! \brief Assets of a gamestate which isn't loaded yet, decoded in the background and handed over to its asset loader. */
+struct Prefetch {
+	struct AssetLoader loader;
+	int count;
+	const char* names[LOADER_MAX_JOBS]; /*!< NULL once claimed. */
+	enum AssetType types[LOADER_MAX_JOBS];
+	void* assets[LOADER_MAX_JOBS];
+	bool finished;
+};
+
+void InitAssetLoader(struct AssetLoader* loader, struct Game* game);
+void LoadBitmapAsync(struct AssetLoader* loader, const char* name, ALLEGRO_BITMAP** out);
+void LoadSampleAsync(struct AssetLoader* loader, const char* name, ALLEGRO_SAMPLE** out);
+void StartAssetLoader(struct AssetLoader* loader, int threads);
+void FinishAssetLoader(struct AssetLoader* loader, void (*progress)(struct Game*));
+
+void PrefetchGamestate(struct Game* game, const char* name);
+void DestroyPrefetch(struct Prefetch* prefetch);
+
+ALLEGRO_FILE* OpenDataFile(struct Game* game, const char* name);
+ALLEGRO_AUDIO_STREAM* LoadAudioStream(struct Game* game, const char* name, size_t buffers, unsigned int samples);
+ALLEGRO_FONT* LoadTTFFont(struct Game* game, const char* name, int size, int flags);
+
+#endif
@@ -18,11 +18,16 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "beachsim.h"
+#include "bench.h"
+#include "golden.h"
 #include "common.h"
 #include "defines.h"
+#include "headless.h"
 #include <libsuperderpy.h>
 #include <signal.h>
 #include <stdio.h>
+#include <string.h>
 
 static _Noreturn void derp(int sig) {
 	ssize_t __attribute__((unused)) n = write(STDERR_FILENO, "Segmentation fault\nI just don't know what went wrong!\n", 54);
@@ -32,28 +37,127 @@ static _Noreturn void derp(int sig) {
 int main(int argc, char** argv) {
 	signal(SIGSEGV, derp);
 
+	if (IsHeadless(argc, argv)) {
+		return RunHeadless(argc, argv);
+	}
+
 	srand(time(NULL));
 
+	// strip our own options, leaving the rest for the engine
+	struct CommonOptions options = {.loader_threads = -1, .people = BEACH_PEOPLE};
+	int args = 1;
+	const char* bench = NULL;
+	int bench_frames = 0;
+	const char* bench_output = NULL;
+	const char* golden = NULL;
+	bool golden_update = false;
+	for (int i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "--record") == 0) && (i + 1 < argc)) {
+			options.record = argv[++i];
+			continue;
+		}
+		if ((strcmp(argv[i], "--trace") == 0) && (i + 1 < argc)) {
+			options.trace = argv[++i];
+			continue;
+		}
+		if ((strcmp(argv[i], "--loader-threads") == 0) && (i + 1 < argc)) {
+			options.loader_threads = atoi(argv[++i]);
+			continue;
+		}
+		if ((strcmp(argv[i], "--people") == 0) && (i + 1 < argc)) {
+			options.people = atoi(argv[++i]);
+			continue;
+		}
+		if ((strcmp(argv[i], "--bench") == 0) && (i + 1 < argc)) {
+			bench = argv[++i];
+			continue;
+		}
+		if ((strcmp(argv[i], "--bench-frames") == 0) && (i + 1 < argc)) {
+			bench_frames = atoi(argv[++i]);
+			continue;
+		}
+		if ((strcmp(argv[i], "--bench-output") == 0) && (i + 1 < argc)) {
+			bench_output = argv[++i];
+			continue;
+		}
+		if ((strcmp(argv[i], "--golden") == 0) && (i + 1 < argc)) {
+			golden = argv[++i];
+			continue;
+		}
+		if (strcmp(argv[i], "--golden-update") == 0) {
+			golden_update = true;
+			continue;
+		}
+		if (strcmp(argv[i], "--rapid-fire") == 0) {
+			options.rapid_fire = true;
+			continue;
+		}
+		if (strcmp(argv[i], "--sim-thread") == 0) {
+			options.sim_thread = true;
+			continue;
+		}
+		if (strcmp(argv[i], "--startup-bench") == 0) {
+			options.startup_bench = true;
+			continue;
+		}
+		argv[args++] = argv[i];
+	}
+	argc = args;
+	argv[argc] = NULL;
+
+	if (golden && !bench) {
+		bench = "all"; // golden frames are taken from benchmark runs, as those are reproducible
+	}
+	if (bench && !IsBenchScenario(bench)) {
+		fprintf(stderr, "Unknown benchmark scenario %s\n", bench);
+		PrintBenchScenarios(stderr);
+		return 1;
+	}
+
 	al_set_org_name("dosowisko.net");
 	al_set_app_name(LIBSUPERDERPY_GAMENAME_PRETTY);
 
 	struct Game* game = libsuperderpy_init(argc, argv, LIBSUPERDERPY_GAMENAME,
 		(struct Params){
-			160,
-			90,
+			VIEWPORT_WIDTH,
+			VIEWPORT_HEIGHT,
+			.integer_scaling = true,
 			.handlers = (struct Handlers){
 				.event = GlobalEventHandler,
 				.destroy = DestroyGameData,
+				.prelogic = PreLogic,
+				.postlogic = PostLogic,
+				.predraw = PreDraw,
+				.postdraw = PostDraw,
 			},
 		});
 	if (!game) { return 1; }
+	if (bench) {
+		options.bench = CreateBench(bench, bench_frames, bench_output);
+	}
+	if (golden) {
+		options.golden = CreateGolden(golden, golden_update);
+	}
 
-	LoadGamestate(game, "dosowisko");
-	StartGamestate(game, "dosowisko");
+	const char* gamestate = "dosowisko";
+	if (options.startup_bench) {
+		gamestate = "beach";
+	} else if (bench) {
+		gamestate = GetBenchGamestate(bench);
+	}
+	LoadGamestate(game, gamestate);
+	StartGamestate(game, gamestate);
 
-	game->data = CreateGameData(game);
+	game->data = CreateGameData(game, options);
 
 	al_hide_mouse_cursor(game->display);
 
-	return libsuperderpy_run(game);
+	int ret = libsuperderpy_run(game);
+	if (options.bench && !FinishBench(options.bench) && !ret) {
+		ret = 1; // something allocated in steady state
+	}
+	if (options.golden && !FinishGolden(options.golden) && !ret) {
+		ret = 1;
+	}
+	return ret;
 }
@@ -0,0 +1,41 @@
+/*! \file manifest.c
+ *  \brief Lists of assets decoded by gamestates, for prefetching them.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "manifest.h"
+#include <stddef.h>
+#include <string.h>
+
+// Keep these in sync with what Gamestate_Load queues; anything missing here simply gets decoded at load time.
+static const char* const beach_bitmaps[] = {"boy.png", "cloud.png", "girl.png", "lost.png", "off.png", "on.png", "power.png",
+	"overlay.png", "sand.png", "sea.png", "corn.png", "towel1.png", "towel2.png", "towel3.png", NULL};
+static const char* const beach_samples[] = {"point.flac", "fail.flac", "throw.flac", NULL};
+
+static const struct AssetManifest manifests[] = {
+	{"beach", beach_bitmaps, beach_samples},
+};
+
+const struct AssetManifest* FindAssetManifest(const char* gamestate) {
+	for (size_t i = 0; i < sizeof(manifests) / sizeof(manifests[0]); i++) {
+		if (strcmp(manifests[i].gamestate, gamestate) == 0) {
+			return &manifests[i];
+		}
+	}
+	return NULL;
+}
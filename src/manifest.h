@@ -0,0 +1,33 @@
+/*! \file manifest.h
+ *  \brief Lists of assets decoded by gamestates, for prefetching them.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+/*! \brief Files which a gamestate's Gamestate_Load decodes with the asset loader. */
+struct AssetManifest {
+	const char* gamestate;
+	const char* const* bitmaps; /*!< NULL terminated. */
+	const char* const* samples; /*!< NULL terminated. */
+};
+
+const struct AssetManifest* FindAssetManifest(const char* gamestate);
+
+#endif
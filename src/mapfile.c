@@ -0,0 +1,96 @@
+/*! \file mapfile.c
+ *  \brief Read-only file mapping with a fallback for platforms without mmap.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mapfile.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static bool ReadWhole(struct MappedFile* file, const char* path) {
+	FILE* fp = fopen(path, "rb");
+	if (!fp) {
+		return false;
+	}
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	if (size < 0) {
+		fclose(fp);
+		return false;
+	}
+	file->size = size;
+	file->data = malloc(file->size ? file->size : 1);
+	file->mapped = false;
+	bool ok = fread(file->data, 1, file->size, fp) == file->size;
+	fclose(fp);
+	if (!ok) {
+		free(file->data);
+	}
+	return ok;
+}
+
+#ifdef HAVE_MMAP
+static bool Map(struct MappedFile* file, const char* path) {
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat st;
+	if ((fstat(fd, &st) < 0) || (st.st_size == 0)) {
+		close(fd);
+		return false;
+	}
+	void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		return false;
+	}
+	file->data = map;
+	file->size = st.st_size;
+	file->mapped = true;
+	return true;
+}
+#endif
+
+bool MapFile(struct MappedFile* file, const char* path) {
+#ifdef HAVE_MMAP
+	if (Map(file, path)) {
+		return true;
+	}
+#endif
+	return ReadWhole(file, path);
+}
+
+void UnmapFile(struct MappedFile* file) {
+#ifdef HAVE_MMAP
+	if (file->mapped) {
+		munmap(file->data, file->size);
+		return;
+	}
+#endif
+	free(file->data);
+}
@@ -0,0 +1,36 @@
+/*! \file mapfile.h
+ *  \brief Read-only file mapping with a fallback for platforms without mmap.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct MappedFile {
+	void* data;
+	size_t size;
+	bool mapped; /*!< false when the file had to be read into memory instead */
+};
+
+bool MapFile(struct MappedFile* file, const char* path);
+void UnmapFile(struct MappedFile* file);
+
+#endif
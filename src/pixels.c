@@ -0,0 +1,62 @@
+/*! \file pixels.c
+ *  \brief Bulk generation of procedural bitmaps.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pixels.h"
+#include <string.h>
+
+// Rows are always handed out as packed ABGR_8888_LE, so the conversion (if any) is left to the driver.
+#define LOCK_FORMAT ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE
+
+void FillBitmapRows(ALLEGRO_BITMAP* bitmap, PixelRowFunc* func, void* data) {
+	int w = al_get_bitmap_width(bitmap), h = al_get_bitmap_height(bitmap);
+	ALLEGRO_LOCKED_REGION* region = al_lock_bitmap(bitmap, LOCK_FORMAT, ALLEGRO_LOCK_WRITEONLY);
+	if (!region) {
+		return;
+	}
+	for (int y = 0; y < h; y++) {
+		func((uint32_t*)((char*)region->data + y * region->pitch), y, w, data);
+	}
+	al_unlock_bitmap(bitmap);
+}
+
+void FillBitmapPattern(ALLEGRO_BITMAP* bitmap, const uint32_t* tile, int tile_width, int tile_height) {
+	int w = al_get_bitmap_width(bitmap), h = al_get_bitmap_height(bitmap);
+	ALLEGRO_LOCKED_REGION* region = al_lock_bitmap(bitmap, LOCK_FORMAT, ALLEGRO_LOCK_WRITEONLY);
+	if (!region) {
+		return;
+	}
+	for (int y = 0; y < h; y++) {
+		char* row = (char*)region->data + y * region->pitch;
+		if (y >= tile_height) {
+			// the pattern repeats vertically, so whole rows can be copied
+			memcpy(row, (char*)region->data + (y - tile_height) * region->pitch, w * 4);
+			continue;
+		}
+		// write one tile row and keep doubling it until the row is full
+		int filled = (tile_width < w) ? tile_width : w;
+		memcpy(row, tile + y * tile_width, filled * 4);
+		while (filled < w) {
+			int n = (filled < w - filled) ? filled : w - filled;
+			memcpy(row + filled * 4, row, n * 4);
+			filled += n;
+		}
+	}
+	al_unlock_bitmap(bitmap);
+}
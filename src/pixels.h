@@ -0,0 +1,38 @@
+/*! \file pixels.h
+ *  \brief Bulk generation of procedural bitmaps.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIXELS_H
+#define PIXELS_H
+
+// Only depends on Allegro itself, so that build tools can use it too.
+#include <allegro5/allegro.h>
+#include <stdint.h>
+
+/*! \brief Packs a color into a ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE pixel (bytes in R, G, B, A order). */
+static inline uint32_t PackPixel(unsigned char r, unsigned char g, unsigned char b, unsigned char a) {
+	return (uint32_t)r | ((uint32_t)g << 8) | ((uint32_t)b << 16) | ((uint32_t)a << 24);
+}
+
+typedef void PixelRowFunc(uint32_t* row, int y, int width, void* data);
+
+void FillBitmapRows(ALLEGRO_BITMAP* bitmap, PixelRowFunc* func, void* data);
+void FillBitmapPattern(ALLEGRO_BITMAP* bitmap, const uint32_t* tile, int tile_width, int tile_height);
+
+#endif
@@ -0,0 +1,92 @@
+/*! \file postprocess.c
+ *  \brief Single-pass post-processing of a gamestate's offscreen layer.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "postprocess.h"
+#include "upscale.h"
+#ifdef ALLEGRO_CFG_OPENGL
+#include <allegro5/allegro_opengl.h>
+#endif
+
+static ALLEGRO_SHADER* BuildShader(struct Game* game, const char* pixel_source) {
+	if (!pixel_source || !(al_get_display_flags(game->display) & ALLEGRO_PROGRAMMABLE_PIPELINE)) {
+		return NULL;
+	}
+	ALLEGRO_SHADER* shader = al_create_shader(ALLEGRO_SHADER_GLSL);
+	if (!shader) {
+		return NULL;
+	}
+	if (!al_attach_shader_source(shader, ALLEGRO_VERTEX_SHADER, al_get_default_shader_source(ALLEGRO_SHADER_GLSL, ALLEGRO_VERTEX_SHADER)) ||
+		!al_attach_shader_source(shader, ALLEGRO_PIXEL_SHADER, pixel_source) ||
+		!al_build_shader(shader)) {
+		PrintConsole(game, "Post-process shader unavailable, using the fallback: %s", al_get_shader_log(shader));
+		al_destroy_shader(shader);
+		return NULL;
+	}
+	return shader;
+}
+
+void InitPostProcess(struct Game* game, struct PostProcess* post, const char* pixel_source, int width, int height, PostProcessFunc* uniforms, PostProcessFunc* fallback, void* data) {
+	post->shader = BuildShader(game, pixel_source);
+	post->buffer = post->shader ? NULL : CreateLowResTarget(width, height);
+	post->uniforms = uniforms;
+	post->fallback = fallback;
+	post->data = data;
+}
+
+static void SetTextureScale(ALLEGRO_BITMAP* source) {
+	float scale[] = {1, 1};
+#ifdef ALLEGRO_CFG_OPENGL
+	int width, height;
+	if (al_get_opengl_texture_size(source, &width, &height) && width && height) {
+		scale[0] = al_get_bitmap_width(source) / (float)width;
+		scale[1] = al_get_bitmap_height(source) / (float)height;
+	}
+#endif
+	al_set_shader_float_vector("texture_scale", 2, scale, 1);
+}
+
+void DrawPostProcess(struct Game* game, struct PostProcess* post, ALLEGRO_BITMAP* source) {
+	ALLEGRO_BITMAP* layer = source;
+	if (!post->shader) {
+		al_set_target_bitmap(post->buffer);
+		post->fallback(game, source, post->data);
+		layer = post->buffer;
+	}
+
+	SetFramebufferAsTarget(game);
+	if (post->shader) {
+		al_use_shader(post->shader);
+		SetTextureScale(source);
+		post->uniforms(game, source, post->data);
+	}
+	DrawUpscaled(game, layer);
+	if (post->shader) {
+		al_use_shader(NULL);
+	}
+}
+
+void DestroyPostProcess(struct PostProcess* post) {
+	if (post->shader) {
+		al_destroy_shader(post->shader);
+	}
+	if (post->buffer) {
+		al_destroy_bitmap(post->buffer);
+	}
+}
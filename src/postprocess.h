@@ -0,0 +1,48 @@
+/*! \file postprocess.h
+ *  \brief Single-pass post-processing of a gamestate's offscreen layer.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef POSTPROCESS_H
+#define POSTPROCESS_H
+
+#include "common.h"
+
+typedef void PostProcessFunc(struct Game* game, ALLEGRO_BITMAP* source, void* data);
+
+/*! \brief Draws a layer onto the framebuffer through a GLSL pixel shader.
+ *
+ * The shader gets the layer as `al_tex`. Allegro keeps textures upside down and may pad them (to a power of two
+ * on GLES and WebGL), so `varying_texcoord` spans the layer from 0 at its bottom left to `texture_scale` at its top
+ * right, which is the layer's size divided by its texture's.
+ * When shaders aren't available, or no source is given, `fallback` draws the effect into
+ * an offscreen buffer of the layer's size instead, which then gets scaled onto the framebuffer.
+ */
+struct PostProcess {
+	ALLEGRO_SHADER* shader;
+	ALLEGRO_BITMAP* buffer; // only used by the fallback
+	PostProcessFunc* uniforms; // called with the shader in use, right before drawing
+	PostProcessFunc* fallback;
+	void* data;
+};
+
+void InitPostProcess(struct Game* game, struct PostProcess* post, const char* pixel_source, int width, int height, PostProcessFunc* uniforms, PostProcessFunc* fallback, void* data);
+void DrawPostProcess(struct Game* game, struct PostProcess* post, ALLEGRO_BITMAP* source);
+void DestroyPostProcess(struct PostProcess* post);
+
+#endif
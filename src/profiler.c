@@ -0,0 +1,146 @@
+/*! \file profiler.c
+ *  \brief Frame timing instrumentation.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "profiler.h"
+#include <stdio.h>
+
+#define PROFILER_WINDOW 600 // how many latest samples of each section are used for the overlay
+
+static const char* names[PROFILER_SECTIONS] = {"frame", "logic", "tick", "draw", "load"};
+
+static int GetThreadId(void) {
+	static atomic_int threads = 0;
+	static _Thread_local int id = -1;
+	if (id < 0) {
+		id = atomic_fetch_add(&threads, 1);
+	}
+	return id;
+}
+
+struct Profiler* CreateProfiler(void) {
+	struct Profiler* profiler = calloc(1, sizeof(struct Profiler));
+	atomic_init(&profiler->head, 0);
+	profiler->epoch = al_get_time();
+	profiler->font = al_create_builtin_font();
+	return profiler;
+}
+
+void DestroyProfiler(struct Profiler* profiler) {
+	al_destroy_font(profiler->font);
+	free(profiler);
+}
+
+void ProfilerRecord(struct Profiler* profiler, enum ProfilerSection section, double start, double duration) {
+	unsigned int index = atomic_fetch_add_explicit(&profiler->head, 1, memory_order_relaxed) & (PROFILER_SAMPLES - 1);
+	struct ProfilerSample* sample = &profiler->samples[index];
+	sample->start = start - profiler->epoch;
+	sample->duration = duration;
+	sample->section = section;
+	sample->thread = GetThreadId();
+}
+
+void ProfilerBegin(struct Profiler* profiler, enum ProfilerSection section) {
+	profiler->begin[section] = al_get_time();
+}
+
+void ProfilerEnd(struct Profiler* profiler, enum ProfilerSection section) {
+	double now = al_get_time();
+	ProfilerRecord(profiler, section, profiler->begin[section], now - profiler->begin[section]);
+}
+
+void ProfilerReset(struct Profiler* profiler) {
+	atomic_store(&profiler->head, 0);
+}
+
+static int CompareDoubles(const void* a, const void* b) {
+	double x = *(const double*)a, y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+// Puts durations of up to `limit` latest samples of the section into the scratch buffer, sorted and in milliseconds.
+static int CollectDurations(struct Profiler* profiler, enum ProfilerSection section, int limit, double* sum) {
+	unsigned int head = atomic_load(&profiler->head);
+	unsigned int available = head < PROFILER_SAMPLES ? head : PROFILER_SAMPLES;
+	int count = 0;
+	*sum = 0;
+	for (unsigned int i = 1; i <= available && count < limit; i++) {
+		const struct ProfilerSample* sample = &profiler->samples[(head - i) & (PROFILER_SAMPLES - 1)];
+		if (sample->section == (int)section) {
+			profiler->scratch[count++] = sample->duration * 1000.0;
+			*sum += sample->duration * 1000.0;
+		}
+	}
+	qsort(profiler->scratch, count, sizeof(double), CompareDoubles);
+	return count;
+}
+
+static void DrawStats(struct Profiler* profiler, enum ProfilerSection section, float y) {
+	double sum;
+	int count = CollectDurations(profiler, section, PROFILER_WINDOW, &sum);
+	if (!count) {
+		return;
+	}
+	al_draw_textf(profiler->font, al_map_rgb(255, 255, 255), 1, y, ALLEGRO_ALIGN_LEFT, "%c%5.1f%5.1f%5.1f",
+		names[section][0] - 'a' + 'A', profiler->scratch[0], sum / count, profiler->scratch[(int)(count * 0.99)]);
+}
+
+void ProfilerDrawOverlay(struct Profiler* profiler) {
+	if (!profiler->overlay) {
+		return;
+	}
+	al_draw_filled_rectangle(0, 0, 130, 4 * 8 + 2, al_map_rgba(0, 0, 0, 160));
+	// min / avg / p99 in milliseconds
+	DrawStats(profiler, PROFILER_FRAME, 1);
+	DrawStats(profiler, PROFILER_LOGIC, 9);
+	DrawStats(profiler, PROFILER_TICK, 17);
+	DrawStats(profiler, PROFILER_DRAW, 25);
+}
+
+bool ProfilerWriteTrace(struct Profiler* profiler, const char* path) {
+	FILE* file = fopen(path, "w");
+	if (!file) {
+		return false;
+	}
+	unsigned int head = atomic_load(&profiler->head);
+	unsigned int first = head < PROFILER_SAMPLES ? 0 : head - PROFILER_SAMPLES;
+
+	fprintf(file, "{\"traceEvents\":[");
+	for (unsigned int i = first; i < head; i++) {
+		const struct ProfilerSample* sample = &profiler->samples[i & (PROFILER_SAMPLES - 1)];
+		fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}", (i == first) ? "" : ",",
+			names[sample->section], sample->start * 1000000.0, sample->duration * 1000000.0, sample->thread);
+	}
+	fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	fclose(file);
+	return true;
+}
+
+void ProfilerWriteStats(struct Profiler* profiler, enum ProfilerSection section, FILE* file) {
+	// a JSON object with the distribution of all samples still in the buffer, in milliseconds
+	double sum;
+	int count = CollectDurations(profiler, section, PROFILER_SAMPLES, &sum);
+	if (!count) {
+		fprintf(file, "{\"samples\":0}");
+		return;
+	}
+	double* d = profiler->scratch;
+	fprintf(file, "{\"samples\":%d,\"min\":%.4f,\"mean\":%.4f,\"p50\":%.4f,\"p90\":%.4f,\"p99\":%.4f,\"max\":%.4f}", count, d[0],
+		sum / count, d[(int)(count * 0.5)], d[(int)(count * 0.9)], d[(int)(count * 0.99)], d[count - 1]);
+}
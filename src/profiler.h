@@ -0,0 +1,69 @@
+/*! \file profiler.h
+ *  \brief Frame timing instrumentation.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "common.h"
+#include <stdatomic.h>
+#include <stdio.h>
+
+#define PROFILER_SAMPLES 16384 // must be a power of two
+
+enum ProfilerSection {
+	PROFILER_FRAME,
+	PROFILER_LOGIC,
+	PROFILER_TICK,
+	PROFILER_DRAW,
+	PROFILER_LOAD,
+	PROFILER_SECTIONS
+};
+
+struct ProfilerSample {
+	double start, duration;
+	int section;
+	int thread;
+};
+
+/*! \brief Lock-free ring buffer of timing samples. Writers never wait; readers may observe a sample being overwritten. */
+struct Profiler {
+	struct ProfilerSample samples[PROFILER_SAMPLES];
+	atomic_uint head;
+	double begin[PROFILER_SECTIONS]; // only used by sections measured from a single thread
+	double epoch;
+	bool overlay;
+	ALLEGRO_FONT* font;
+	double scratch[PROFILER_SAMPLES];
+};
+
+struct Profiler* CreateProfiler(void);
+void DestroyProfiler(struct Profiler* profiler);
+
+void ProfilerRecord(struct Profiler* profiler, enum ProfilerSection section, double start, double duration);
+void ProfilerBegin(struct Profiler* profiler, enum ProfilerSection section);
+void ProfilerEnd(struct Profiler* profiler, enum ProfilerSection section);
+
+void ProfilerReset(struct Profiler* profiler);
+
+void ProfilerDrawOverlay(struct Profiler* profiler);
+bool ProfilerWriteTrace(struct Profiler* profiler, const char* path);
+void ProfilerWriteStats(struct Profiler* profiler, enum ProfilerSection section, FILE* file);
+
+#endif
@@ -0,0 +1,147 @@
+/*! \file replay.c
+ *  \brief Recording and verification of beach input replays.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "replay.h"
+#include "beachsim.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define REPLAY_HEADER_SIZE 8
+
+static void WriteU32(unsigned char* buf, uint32_t value) {
+	for (int i = 0; i < 4; i++) {
+		buf[i] = (value >> (i * 8)) & 0xFF;
+	}
+}
+
+struct ReplayWriter* ReplayWriterOpen(const char* path) {
+	FILE* file = fopen(path, "wb");
+	if (!file) {
+		return NULL;
+	}
+	unsigned char header[REPLAY_HEADER_SIZE];
+	memcpy(header, REPLAY_MAGIC, 4);
+	WriteU32(header + 4, REPLAY_VERSION);
+	fwrite(header, REPLAY_HEADER_SIZE, 1, file);
+
+	struct ReplayWriter* writer = calloc(1, sizeof(struct ReplayWriter));
+	writer->file = file;
+	return writer;
+}
+
+void ReplayWrite(struct ReplayWriter* writer, uint32_t tick, enum ReplayRecordType type, uint64_t value) {
+	unsigned char buf[sizeof(struct ReplayRecord)];
+	WriteU32(buf, tick);
+	WriteU32(buf + 4, type);
+	WriteU32(buf + 8, value & 0xFFFFFFFF);
+	WriteU32(buf + 12, value >> 32);
+	fwrite(buf, sizeof(buf), 1, writer->file);
+}
+
+void ReplayWriterClose(struct ReplayWriter* writer) {
+	fclose(writer->file);
+	free(writer);
+}
+
+struct Replay* ReplayOpen(const char* path) {
+	struct Replay* replay = calloc(1, sizeof(struct Replay));
+	if (!MapFile(&replay->file, path)) {
+		free(replay);
+		return NULL;
+	}
+
+	const unsigned char* header = replay->file.data;
+	if ((replay->file.size < REPLAY_HEADER_SIZE) || (memcmp(header, REPLAY_MAGIC, 4) != 0) ||
+		(header[4] != REPLAY_VERSION) || (header[5] != 0) || (header[6] != 0) || (header[7] != 0)) {
+		ReplayClose(replay);
+		return NULL;
+	}
+	// Records are stored in host layout, which is little-endian on every supported platform.
+	replay->records = (const struct ReplayRecord*)(header + REPLAY_HEADER_SIZE);
+	replay->count = (replay->file.size - REPLAY_HEADER_SIZE) / sizeof(struct ReplayRecord);
+	return replay;
+}
+
+void ReplayClose(struct Replay* replay) {
+	UnmapFile(&replay->file);
+	free(replay);
+}
+
+struct ReplayResult ReplayVerify(const struct Replay* replay) {
+	struct ReplayResult result = {.ok = true, .diverged = -1};
+	struct BeachSim sim = {0};
+	bool initialized = false;
+	int people = BEACH_PEOPLE;
+	bool rapid_fire = false;
+
+	for (size_t i = 0; i < replay->count; i++) {
+		const struct ReplayRecord* record = &replay->records[i];
+
+		if (record->type == REPLAY_PEOPLE) {
+			people = (record->value > BEACH_MAX_PEOPLE) ? BEACH_MAX_PEOPLE : (int)record->value;
+			continue;
+		}
+		if (record->type == REPLAY_RAPID_FIRE) {
+			rapid_fire = record->value != 0;
+			continue;
+		}
+		if (record->type == REPLAY_SEED) {
+			BeachSimDestroy(&sim);
+			BeachSimInit(&sim, record->value, people);
+			sim.rapid_fire = rapid_fire;
+			sim.events = 0;
+			initialized = true;
+			continue;
+		}
+		if (!initialized || ((uint32_t)sim.frames > record->tick)) {
+			result.ok = false;
+		} else {
+			while ((uint32_t)sim.frames < record->tick) {
+				BeachSimTick(&sim);
+				sim.events = 0;
+				result.ticks++;
+			}
+			switch (record->type) {
+				case REPLAY_PRESS:
+					BeachSimPress(&sim);
+					break;
+				case REPLAY_RELEASE:
+					BeachSimRelease(&sim);
+					break;
+				case REPLAY_HASH:
+					result.ok = BeachSimHash(&sim) == record->value;
+					break;
+				default:
+					result.ok = false;
+			}
+			sim.events = 0;
+		}
+
+		if (!result.ok) {
+			result.diverged = (int64_t)i;
+			result.diverged_tick = record->tick;
+			break;
+		}
+	}
+
+	result.score = initialized ? sim.score : 0;
+	BeachSimDestroy(&sim);
+	return result;
+}
@@ -0,0 +1,77 @@
+/*! \file replay.h
+ *  \brief Recording and verification of beach input replays.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "mapfile.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// A replay file is an 8 byte header followed by an array of fixed-size little-endian records,
+// so it can be both mapped into memory and read sequentially.
+#define REPLAY_MAGIC "BCRP"
+#define REPLAY_VERSION 1
+
+enum ReplayRecordType {
+	REPLAY_SEED, /*!< The simulation has been (re)initialized with the seed in `value`. */
+	REPLAY_PRESS, /*!< BeachSimPress has been called. */
+	REPLAY_RELEASE, /*!< BeachSimRelease has been called. */
+	REPLAY_HASH, /*!< BeachSimHash after the tick was `value`. */
+	REPLAY_PEOPLE, /*!< Crowd size for the following REPLAY_SEED, BEACH_PEOPLE if not present. */
+	REPLAY_RAPID_FIRE, /*!< Whether rapid fire is enabled after the following REPLAY_SEED, off if not present. */
+};
+
+struct ReplayRecord {
+	uint32_t tick; /*!< Number of ticks simulated since the last REPLAY_SEED. */
+	uint32_t type;
+	uint64_t value;
+};
+
+struct ReplayWriter {
+	FILE* file;
+};
+
+struct Replay {
+	const struct ReplayRecord* records;
+	size_t count;
+	struct MappedFile file;
+};
+
+/*! \brief Result of playing a replay back. */
+struct ReplayResult {
+	bool ok;
+	uint32_t ticks; /*!< Number of ticks simulated. */
+	int64_t diverged; /*!< Index of the first record which didn't match, or -1. */
+	uint32_t diverged_tick;
+	int score; /*!< Score at the end of the replay. */
+};
+
+struct ReplayWriter* ReplayWriterOpen(const char* path);
+void ReplayWrite(struct ReplayWriter* writer, uint32_t tick, enum ReplayRecordType type, uint64_t value);
+void ReplayWriterClose(struct ReplayWriter* writer);
+
+struct Replay* ReplayOpen(const char* path);
+void ReplayClose(struct Replay* replay);
+struct ReplayResult ReplayVerify(const struct Replay* replay);
+
+#endif
@@ -0,0 +1,219 @@
+/*! \file simthread.c
+ *  \brief Running the beach simulation on its own thread.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "simthread.h"
+#include "profiler.h"
+#include "replay.h"
+
+#define SIMTHREAD_FRESH 4u
+
+void TakeSimEvents(struct SimEvents* events, struct BeachSim* sim) {
+	events->events = sim->events;
+	events->corn = sim->corn;
+	events->lost = sim->lost;
+	memcpy(events->lostx, sim->lostx, sizeof(events->lostx));
+	memcpy(events->losty, sim->losty, sizeof(events->losty));
+	sim->events = 0;
+}
+
+static void CopySnapshot(struct SimSnapshot* snapshot, const struct BeachSim* sim) {
+	BeachSnapshotView(&snapshot->state, sim);
+	int count = sim->people.count;
+	if (count > snapshot->capacity) {
+		// only happens when the crowd grows, as StartSimThread sizes all snapshots up front
+		free(snapshot->storage);
+		snapshot->storage = malloc(count * (2 * sizeof(int) + 3 * sizeof(uint8_t)));
+		snapshot->capacity = count;
+	}
+	int* x = snapshot->storage;
+	int* y = x + count;
+	uint8_t* satisfied = (uint8_t*)(y + count);
+	uint8_t* boy = satisfied + count;
+	uint8_t* towel = boy + count;
+	memcpy(x, sim->people.x, count * sizeof(int));
+	memcpy(y, sim->people.y, count * sizeof(int));
+	memcpy(satisfied, sim->people.satisfied, count * sizeof(uint8_t));
+	memcpy(boy, sim->people.boy, count * sizeof(uint8_t));
+	memcpy(towel, sim->people.towel, count * sizeof(uint8_t));
+	snapshot->state.x = x;
+	snapshot->state.y = y;
+	snapshot->state.satisfied = satisfied;
+	snapshot->state.boy = boy;
+	snapshot->state.towel = towel;
+}
+
+static void Publish(struct SimThread* thread) {
+	struct SimSnapshot* snapshot = &thread->snapshots[thread->back];
+	CopySnapshot(snapshot, thread->sim);
+	snapshot->serial = thread->serial;
+	snapshot->time = al_get_time();
+	thread->back = (int)(atomic_exchange(&thread->middle, thread->back | SIMTHREAD_FRESH) & ~SIMTHREAD_FRESH);
+}
+
+const struct SimSnapshot* SimThreadAcquire(struct SimThread* thread) {
+	if (atomic_load(&thread->middle) & SIMTHREAD_FRESH) {
+		thread->front = (int)(atomic_exchange(&thread->middle, thread->front) & ~SIMTHREAD_FRESH);
+	}
+	return &thread->snapshots[thread->front];
+}
+
+static void PushEvents(struct SimThread* thread) {
+	unsigned int head = atomic_load_explicit(&thread->events_head, memory_order_relaxed);
+	while (head - atomic_load_explicit(&thread->events_tail, memory_order_acquire) == SIMTHREAD_EVENTS) {
+		if (atomic_load(&thread->quit)) {
+			return; // nobody is going to read them anymore
+		}
+		// drawing has been stalled for seconds; losing a scroll step would leave the canvas misaligned for good
+		al_rest(0.001);
+	}
+	struct SimEvents* events = &thread->events[head & (SIMTHREAD_EVENTS - 1)];
+	TakeSimEvents(events, thread->sim);
+	events->serial = thread->serial;
+	atomic_store_explicit(&thread->events_head, head + 1, memory_order_release);
+}
+
+bool SimThreadPollEvents(struct SimThread* thread, uint64_t serial, struct SimEvents* events) {
+	// Only events up to the given snapshot are returned, so that they're never handled before it gets drawn.
+	unsigned int tail = atomic_load_explicit(&thread->events_tail, memory_order_relaxed);
+	if (tail == atomic_load_explicit(&thread->events_head, memory_order_acquire)) {
+		return false;
+	}
+	const struct SimEvents* next = &thread->events[tail & (SIMTHREAD_EVENTS - 1)];
+	if (next->serial > serial) {
+		return false;
+	}
+	*events = *next;
+	atomic_store_explicit(&thread->events_tail, tail + 1, memory_order_release);
+	return true;
+}
+
+void SimThreadInput(struct SimThread* thread, enum BeachInput input) {
+	unsigned int head = atomic_load_explicit(&thread->inputs_head, memory_order_relaxed);
+	if (head - atomic_load_explicit(&thread->inputs_tail, memory_order_acquire) == SIMTHREAD_INPUTS) {
+		return; // nobody can press a button that many times within a tick
+	}
+	thread->inputs[head & (SIMTHREAD_INPUTS - 1)] = input;
+	atomic_store_explicit(&thread->inputs_head, head + 1, memory_order_release);
+}
+
+static void Apply(struct SimThread* thread, unsigned int input) {
+	if (input & BEACH_INPUT_PRESS) {
+		if (thread->recorder) {
+			ReplayWrite(thread->recorder, thread->sim->frames, REPLAY_PRESS, 0);
+		}
+		BeachSimPress(thread->sim);
+	}
+	if (input & BEACH_INPUT_RELEASE) {
+		if (thread->recorder) {
+			ReplayWrite(thread->recorder, thread->sim->frames, REPLAY_RELEASE, 0);
+		}
+		BeachSimRelease(thread->sim);
+	}
+}
+
+static void Step(struct SimThread* thread) {
+	// Events from inputs and the tick itself are all reported together, along with the snapshot that shows them.
+	unsigned int tail = atomic_load_explicit(&thread->inputs_tail, memory_order_relaxed);
+	while (tail != atomic_load_explicit(&thread->inputs_head, memory_order_acquire)) {
+		Apply(thread, thread->inputs[tail & (SIMTHREAD_INPUTS - 1)]);
+		atomic_store_explicit(&thread->inputs_tail, ++tail, memory_order_release);
+	}
+	if (thread->autoplayer) {
+		Apply(thread, BeachAutoplay(thread->autoplayer, thread->sim));
+	}
+
+	ProfilerBegin(thread->profiler, PROFILER_TICK);
+	BeachSimTick(thread->sim);
+	if (thread->recorder) {
+		ReplayWrite(thread->recorder, thread->sim->frames, REPLAY_HASH, BeachSimHash(thread->sim));
+	}
+	thread->serial++;
+	if (thread->sim->events) {
+		PushEvents(thread);
+	}
+	Publish(thread);
+	ProfilerEnd(thread->profiler, PROFILER_TICK);
+}
+
+static void* Run(ALLEGRO_THREAD* t, void* arg) {
+	struct SimThread* thread = arg;
+	double next = al_get_time() + BEACH_TICK;
+	while (!atomic_load(&thread->quit)) {
+		double now = al_get_time();
+		if (now < next) {
+			al_rest(next - now);
+			continue;
+		}
+		if (now - next > BEACH_MAX_CATCHUP_TICKS * BEACH_TICK) {
+			next = now;
+		}
+		Step(thread);
+		next += BEACH_TICK;
+	}
+	return NULL;
+}
+
+bool StartSimThread(struct SimThread* thread, struct BeachSim* sim, struct BeachAutoplayer* autoplayer, struct ReplayWriter* recorder, struct Profiler* profiler) {
+	thread->sim = sim;
+	thread->autoplayer = autoplayer;
+	thread->recorder = recorder;
+	thread->profiler = profiler;
+	thread->serial = 0;
+	thread->front = 0;
+	thread->back = 2;
+	atomic_store(&thread->middle, 1);
+	atomic_store(&thread->events_head, 0);
+	atomic_store(&thread->events_tail, 0);
+	atomic_store(&thread->inputs_head, 0);
+	atomic_store(&thread->inputs_tail, 0);
+	atomic_store(&thread->quit, false);
+	for (int i = 0; i < 3; i++) {
+		CopySnapshot(&thread->snapshots[i], sim);
+		thread->snapshots[i].serial = 0;
+		thread->snapshots[i].time = al_get_time();
+	}
+
+	thread->thread = al_create_thread(Run, thread);
+	if (!thread->thread) {
+		return false;
+	}
+	al_start_thread(thread->thread);
+	return true;
+}
+
+void StopSimThread(struct SimThread* thread) {
+	// Whatever has been published stays available to SimThreadAcquire and SimThreadPollEvents.
+	if (!thread->thread) {
+		return;
+	}
+	atomic_store(&thread->quit, true);
+	al_join_thread(thread->thread, NULL);
+	al_destroy_thread(thread->thread);
+	thread->thread = NULL;
+}
+
+void DestroySimThread(struct SimThread* thread) {
+	StopSimThread(thread);
+	for (int i = 0; i < 3; i++) {
+		free(thread->snapshots[i].storage);
+		thread->snapshots[i].storage = NULL;
+		thread->snapshots[i].capacity = 0;
+	}
+}
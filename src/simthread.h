@@ -0,0 +1,86 @@
+/*! \file simthread.h
+ *  \brief Running the beach simulation on its own thread.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SIMTHREAD_H
+#define SIMTHREAD_H
+
+#include "beachsim.h"
+#include "common.h"
+#include <stdatomic.h>
+
+#define SIMTHREAD_EVENTS 256 // must be a power of two
+#define SIMTHREAD_INPUTS 64 // must be a power of two
+
+/*! \brief Events reported by the simulation during a single tick, together with what the presentation needs to react to them. */
+struct SimEvents {
+	uint64_t serial; /*!< Snapshot which already shows their effects. */
+	unsigned int events; /*!< Bitmask of BeachEvent. */
+	int corn;
+	int lost;
+	int lostx[BEACH_MAX_CORNS], losty[BEACH_MAX_CORNS];
+};
+
+/*! \brief A published state of the beach, along with the copy of the people it points at. */
+struct SimSnapshot {
+	struct BeachSnapshot state;
+	uint64_t serial; /*!< Number of ticks simulated before it since the thread was started. */
+	double time; /*!< When it was published, for interpolating towards the next one. */
+	void* storage;
+	int capacity;
+};
+
+/*! \brief Steps the simulation in real time on a separate thread, so that drawing never delays a tick.
+ *
+ * Snapshots are passed to the drawing thread through a lock-free triple buffer, so neither side ever waits
+ * for the other and the newest one is always available. Events and inputs go through single producer,
+ * single consumer ring buffers, since none of them may be dropped.
+ */
+struct SimThread {
+	struct BeachSim* sim; /*!< Owned by the thread while it runs. */
+	struct BeachAutoplayer* autoplayer; /*!< Pressing the button instead of the player, if set. */
+	struct ReplayWriter* recorder;
+	struct Profiler* profiler;
+
+	struct SimSnapshot snapshots[3];
+	atomic_uint middle; /*!< Index of the snapshot in between, with SIMTHREAD_FRESH set if it wasn't taken yet. */
+	int back; /*!< Being written by the simulation thread. */
+	int front; /*!< Being drawn. */
+	uint64_t serial;
+
+	struct SimEvents events[SIMTHREAD_EVENTS];
+	atomic_uint events_head, events_tail;
+	unsigned char inputs[SIMTHREAD_INPUTS];
+	atomic_uint inputs_head, inputs_tail;
+
+	atomic_bool quit;
+	ALLEGRO_THREAD* thread;
+};
+
+void TakeSimEvents(struct SimEvents* events, struct BeachSim* sim);
+
+bool StartSimThread(struct SimThread* thread, struct BeachSim* sim, struct BeachAutoplayer* autoplayer, struct ReplayWriter* recorder, struct Profiler* profiler);
+void StopSimThread(struct SimThread* thread);
+void DestroySimThread(struct SimThread* thread);
+
+void SimThreadInput(struct SimThread* thread, enum BeachInput input);
+const struct SimSnapshot* SimThreadAcquire(struct SimThread* thread);
+bool SimThreadPollEvents(struct SimThread* thread, uint64_t serial, struct SimEvents* events);
+
+#endif
@@ -0,0 +1,167 @@
+/*! \file textcache.c
+ *  \brief Cache of pre-rendered outlined text.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "textcache.h"
+
+static void DrawOutline(ALLEGRO_FONT* font, ALLEGRO_COLOR outline_color, float x, float y, int flags, const char* text) {
+	al_draw_text(font, outline_color, x + 1, y + 1, flags, text);
+	al_draw_text(font, outline_color, x - 1, y - 1, flags, text);
+	al_draw_text(font, outline_color, x + 1, y - 1, flags, text);
+	al_draw_text(font, outline_color, x - 1, y + 1, flags, text);
+	al_draw_text(font, outline_color, x - 1, y, flags, text);
+	al_draw_text(font, outline_color, x + 1, y, flags, text);
+	al_draw_text(font, outline_color, x, y - 1, flags, text);
+	al_draw_text(font, outline_color, x, y + 1, flags, text);
+}
+
+void DrawTextWithOutline(ALLEGRO_FONT* font, ALLEGRO_COLOR color, ALLEGRO_COLOR outline_color, float x, float y, int flags, const char* text) {
+	DrawOutline(font, outline_color, x, y, flags, text);
+	al_draw_text(font, color, x, y, flags, text);
+}
+
+static bool SameColor(ALLEGRO_COLOR a, ALLEGRO_COLOR b) {
+	return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+static struct TextCacheEntry* GetEntry(struct TextCache* cache, ALLEGRO_FONT* font, ALLEGRO_COLOR color, ALLEGRO_COLOR outline_color, const char* text) {
+	struct TextCacheEntry* oldest = &cache->entries[0];
+	for (int i = 0; i < TEXT_CACHE_SIZE; i++) {
+		struct TextCacheEntry* entry = &cache->entries[i];
+		if (entry->bitmap && entry->font == font && SameColor(entry->color, color) && SameColor(entry->outline_color, outline_color) && strcmp(entry->text, text) == 0) {
+			return entry;
+		}
+		if (!entry->bitmap || (oldest->bitmap && entry->used < oldest->used)) {
+			oldest = entry;
+		}
+	}
+
+	// Not cached yet, render it in place of the least recently used entry.
+	if (oldest->bitmap) {
+		al_destroy_bitmap(oldest->bitmap);
+	}
+	bool held = al_is_bitmap_drawing_held();
+	if (held) {
+		al_hold_bitmap_drawing(false);
+	}
+	ALLEGRO_STATE state;
+	al_store_state(&state, ALLEGRO_STATE_TARGET_BITMAP | ALLEGRO_STATE_NEW_BITMAP_PARAMETERS);
+	al_set_new_bitmap_flags(al_get_new_bitmap_flags() & ~(ALLEGRO_MAG_LINEAR | ALLEGRO_MIN_LINEAR));
+	oldest->bitmap = al_create_bitmap(al_get_text_width(font, text) + 2, al_get_font_line_height(font) + 2);
+	al_set_target_bitmap(oldest->bitmap);
+	al_clear_to_color(al_map_rgba(0, 0, 0, 0));
+	DrawTextWithOutline(font, color, outline_color, 1, 1, ALLEGRO_ALIGN_LEFT, text);
+	al_restore_state(&state);
+	if (held) {
+		al_hold_bitmap_drawing(true);
+	}
+
+	oldest->font = font;
+	oldest->color = color;
+	oldest->outline_color = outline_color;
+	strncpy(oldest->text, text, TEXT_CACHE_MAX_LENGTH);
+	return oldest;
+}
+
+void DrawCachedTextWithOutline(struct TextCache* cache, ALLEGRO_FONT* font, ALLEGRO_COLOR color, ALLEGRO_COLOR outline_color, float x, float y, int flags, const char* text) {
+	if (strlen(text) >= TEXT_CACHE_MAX_LENGTH) {
+		DrawTextWithOutline(font, color, outline_color, x, y, flags, text);
+		return;
+	}
+
+	struct TextCacheEntry* entry = GetEntry(cache, font, color, outline_color, text);
+	entry->used = ++cache->clock;
+
+	float width = al_get_bitmap_width(entry->bitmap) - 2;
+	if (flags & ALLEGRO_ALIGN_RIGHT) {
+		x -= width;
+	} else if (flags & ALLEGRO_ALIGN_CENTRE) {
+		x -= width / 2.0;
+	}
+	al_draw_bitmap(entry->bitmap, x - 1, y - 1, 0);
+}
+
+void ClearTextCache(struct TextCache* cache) {
+	for (int i = 0; i < TEXT_CACHE_SIZE; i++) {
+		if (cache->entries[i].bitmap) {
+			al_destroy_bitmap(cache->entries[i].bitmap);
+		}
+	}
+	memset(cache, 0, sizeof(struct TextCache));
+}
+
+void InitDigitStrip(struct DigitStrip* strip, ALLEGRO_FONT* font, ALLEGRO_COLOR color, ALLEGRO_COLOR outline_color) {
+	int width = 0;
+	for (int i = 0; i < DIGIT_STRIP_SIZE; i++) {
+		char glyph[2] = {DIGIT_STRIP_CHARS[i], 0};
+		strip->x[i] = width;
+		strip->width[i] = al_get_text_width(font, glyph);
+		width += strip->width[i] + 2;
+	}
+	strip->height = al_get_font_line_height(font) + 2;
+
+	ALLEGRO_STATE state;
+	al_store_state(&state, ALLEGRO_STATE_TARGET_BITMAP | ALLEGRO_STATE_NEW_BITMAP_PARAMETERS);
+	al_set_new_bitmap_flags(al_get_new_bitmap_flags() & ~(ALLEGRO_MAG_LINEAR | ALLEGRO_MIN_LINEAR));
+	strip->bitmap = al_create_bitmap(width, strip->height * 2);
+	al_set_target_bitmap(strip->bitmap);
+	al_clear_to_color(al_map_rgba(0, 0, 0, 0));
+	for (int i = 0; i < DIGIT_STRIP_SIZE; i++) {
+		char glyph[2] = {DIGIT_STRIP_CHARS[i], 0};
+		DrawOutline(font, outline_color, strip->x[i] + 1, 1, ALLEGRO_ALIGN_LEFT, glyph);
+		al_draw_text(font, color, strip->x[i] + 1, strip->height + 1, ALLEGRO_ALIGN_LEFT, glyph);
+	}
+	al_restore_state(&state);
+}
+
+void DrawDigitsWithOutline(struct DigitStrip* strip, float x, float y, int flags, const char* text) {
+	float width = 0;
+	for (const char* c = text; *c; c++) {
+		const char* glyph = strchr(DIGIT_STRIP_CHARS, *c);
+		if (glyph) {
+			width += strip->width[glyph - DIGIT_STRIP_CHARS];
+		}
+	}
+	if (flags & ALLEGRO_ALIGN_RIGHT) {
+		x -= width;
+	} else if (flags & ALLEGRO_ALIGN_CENTRE) {
+		x -= width / 2.0;
+	}
+
+	// All outlines go first, as in DrawTextWithOutline, so that they don't cover the neighbouring digits.
+	for (int row = 0; row < 2; row++) {
+		float cx = x;
+		for (const char* c = text; *c; c++) {
+			const char* glyph = strchr(DIGIT_STRIP_CHARS, *c);
+			if (!glyph) {
+				continue;
+			}
+			int i = glyph - DIGIT_STRIP_CHARS;
+			al_draw_bitmap_region(strip->bitmap, strip->x[i], row * strip->height, strip->width[i] + 2, strip->height, cx - 1, y - 1, 0);
+			cx += strip->width[i];
+		}
+	}
+}
+
+void DestroyDigitStrip(struct DigitStrip* strip) {
+	if (strip->bitmap) {
+		al_destroy_bitmap(strip->bitmap);
+	}
+	memset(strip, 0, sizeof(struct DigitStrip));
+}
@@ -0,0 +1,59 @@
+/*! \file textcache.h
+ *  \brief Cache of pre-rendered outlined text.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TEXTCACHE_H
+#define TEXTCACHE_H
+
+#include "common.h"
+
+#define TEXT_CACHE_SIZE 8
+#define TEXT_CACHE_MAX_LENGTH 64
+#define DIGIT_STRIP_CHARS "0123456789-"
+#define DIGIT_STRIP_SIZE 11
+
+struct TextCacheEntry {
+	ALLEGRO_BITMAP* bitmap;
+	const ALLEGRO_FONT* font;
+	ALLEGRO_COLOR color, outline_color;
+	char text[TEXT_CACHE_MAX_LENGTH];
+	unsigned int used;
+};
+
+/*! \brief Least recently used cache of text rendered with an outline, keyed by its content. */
+struct TextCache {
+	struct TextCacheEntry entries[TEXT_CACHE_SIZE];
+	unsigned int clock;
+};
+
+/*! \brief Digits rendered with an outline once, so that numbers changing every few frames don't need new bitmaps. */
+struct DigitStrip {
+	ALLEGRO_BITMAP* bitmap; // outlines in the top row, the digits themselves in the bottom one
+	int x[DIGIT_STRIP_SIZE], width[DIGIT_STRIP_SIZE];
+	int height;
+};
+
+void DrawTextWithOutline(ALLEGRO_FONT* font, ALLEGRO_COLOR color, ALLEGRO_COLOR outline_color, float x, float y, int flags, const char* text);
+void DrawCachedTextWithOutline(struct TextCache* cache, ALLEGRO_FONT* font, ALLEGRO_COLOR color, ALLEGRO_COLOR outline_color, float x, float y, int flags, const char* text);
+void ClearTextCache(struct TextCache* cache);
+void InitDigitStrip(struct DigitStrip* strip, ALLEGRO_FONT* font, ALLEGRO_COLOR color, ALLEGRO_COLOR outline_color);
+void DrawDigitsWithOutline(struct DigitStrip* strip, float x, float y, int flags, const char* text);
+void DestroyDigitStrip(struct DigitStrip* strip);
+
+#endif
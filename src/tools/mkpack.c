@@ -0,0 +1,185 @@
+/*! \file mkpack.c
+ *  \brief Build-time tool generating the asset pack out of the data directory.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Usage: boiledcorn-mkpack OUTPUT DATADIR [-b BITMAP | -s SAMPLE | -f FILE]...
+// Bitmaps and samples get decoded, files are stored as they are.
+
+#include "../assetpack.h"
+#include <allegro5/allegro.h>
+#include <allegro5/allegro_acodec.h>
+#include <allegro5/allegro_audio.h>
+#include <allegro5/allegro_image.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct Asset {
+	struct AssetPackEntry entry;
+	void* data;
+};
+
+static void* ReadFile(const char* path, uint32_t* size) {
+	FILE* file = fopen(path, "rb");
+	if (!file) {
+		return NULL;
+	}
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	void* data = malloc(length > 0 ? length : 1);
+	if ((length < 0) || (fread(data, 1, length, file) != (size_t)length)) {
+		free(data);
+		fclose(file);
+		return NULL;
+	}
+	fclose(file);
+	*size = length;
+	return data;
+}
+
+static void* DecodeBitmap(const char* path, struct AssetPackEntry* entry) {
+	al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+	al_set_new_bitmap_format(ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE);
+	ALLEGRO_BITMAP* bitmap = al_load_bitmap(path);
+	if (!bitmap) {
+		return NULL;
+	}
+	int w = al_get_bitmap_width(bitmap), h = al_get_bitmap_height(bitmap);
+	char* data = malloc(w * h * 4);
+	ALLEGRO_LOCKED_REGION* region = al_lock_bitmap(bitmap, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_READONLY);
+	for (int y = 0; y < h; y++) {
+		memcpy(data + y * w * 4, (char*)region->data + y * region->pitch, w * 4);
+	}
+	al_unlock_bitmap(bitmap);
+	al_destroy_bitmap(bitmap);
+
+	entry->size = w * h * 4;
+	entry->params[0] = w;
+	entry->params[1] = h;
+	return data;
+}
+
+static void* DecodeSample(const char* path, struct AssetPackEntry* entry) {
+	ALLEGRO_SAMPLE* sample = al_load_sample(path);
+	if (!sample) {
+		return NULL;
+	}
+	unsigned int length = al_get_sample_length(sample);
+	ALLEGRO_AUDIO_DEPTH depth = al_get_sample_depth(sample);
+	ALLEGRO_CHANNEL_CONF conf = al_get_sample_channels(sample);
+	entry->size = length * al_get_channel_count(conf) * al_get_audio_depth_size(depth);
+	entry->params[0] = length;
+	entry->params[1] = al_get_sample_frequency(sample);
+	entry->params[2] = depth;
+	entry->params[3] = conf;
+
+	void* data = malloc(entry->size ? entry->size : 1);
+	memcpy(data, al_get_sample_data(sample), entry->size);
+	al_destroy_sample(sample);
+	return data;
+}
+
+static int CompareAssets(const void* a, const void* b) {
+	return strncmp(((const struct Asset*)a)->entry.name, ((const struct Asset*)b)->entry.name, ASSETPACK_NAME_LENGTH);
+}
+
+static uint64_t Align(uint64_t offset) {
+	return (offset + ASSETPACK_ALIGNMENT - 1) / ASSETPACK_ALIGNMENT * ASSETPACK_ALIGNMENT;
+}
+
+int main(int argc, char** argv) {
+	if ((argc < 3) || (argc % 2 != 1)) {
+		fprintf(stderr, "Usage: %s OUTPUT DATADIR [-b BITMAP | -s SAMPLE | -f FILE]...\n", argv[0]);
+		return 1;
+	}
+	al_init();
+	al_init_image_addon();
+	al_install_audio();
+	al_init_acodec_addon();
+
+	int count = (argc - 3) / 2;
+	struct Asset* assets = calloc(count ? count : 1, sizeof(struct Asset));
+	for (int i = 0; i < count; i++) {
+		const char* type = argv[3 + i * 2];
+		const char* name = argv[4 + i * 2];
+		struct AssetPackEntry* entry = &assets[i].entry;
+		if (strlen(name) >= ASSETPACK_NAME_LENGTH) {
+			fprintf(stderr, "Asset name too long: %s\n", name);
+			return 1;
+		}
+		strncpy(entry->name, name, ASSETPACK_NAME_LENGTH);
+
+		char path[4096];
+		snprintf(path, sizeof(path), "%s/%s", argv[2], name);
+		if (strcmp(type, "-b") == 0) {
+			entry->type = ASSETPACK_BITMAP;
+			assets[i].data = DecodeBitmap(path, entry);
+		} else if (strcmp(type, "-s") == 0) {
+			entry->type = ASSETPACK_SAMPLE;
+			assets[i].data = DecodeSample(path, entry);
+		} else if (strcmp(type, "-f") == 0) {
+			entry->type = ASSETPACK_FILE;
+			assets[i].data = ReadFile(path, &entry->size);
+		} else {
+			fprintf(stderr, "Unknown asset type: %s\n", type);
+			return 1;
+		}
+		if (!assets[i].data) {
+			fprintf(stderr, "Cannot load %s!\n", path);
+			return 1;
+		}
+	}
+	qsort(assets, count, sizeof(struct Asset), CompareAssets);
+
+	uint64_t offset = sizeof(struct AssetPackHeader) + count * sizeof(struct AssetPackEntry);
+	for (int i = 0; i < count; i++) {
+		offset = Align(offset);
+		assets[i].entry.offset = offset;
+		offset += assets[i].entry.size;
+	}
+
+	FILE* out = fopen(argv[1], "wb");
+	if (!out) {
+		fprintf(stderr, "Cannot open %s for writing!\n", argv[1]);
+		return 1;
+	}
+	struct AssetPackHeader header = {.version = ASSETPACK_VERSION, .count = count};
+	memcpy(header.magic, ASSETPACK_MAGIC, 4);
+	fwrite(&header, sizeof(header), 1, out);
+	for (int i = 0; i < count; i++) {
+		fwrite(&assets[i].entry, sizeof(struct AssetPackEntry), 1, out);
+	}
+	static const char padding[ASSETPACK_ALIGNMENT];
+	for (int i = 0; i < count; i++) {
+		fwrite(padding, 1, assets[i].entry.offset - ftell(out), out);
+		fwrite(assets[i].data, 1, assets[i].entry.size, out);
+		free(assets[i].data);
+	}
+	bool ok = ferror(out) == 0;
+	fclose(out);
+	free(assets);
+
+	if (!ok) {
+		fprintf(stderr, "Cannot write %s!\n", argv[1]);
+		remove(argv[1]);
+		return 1;
+	}
+	return 0;
+}
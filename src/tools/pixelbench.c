@@ -0,0 +1,98 @@
+/*! \file pixelbench.c
+ *  \brief Micro-benchmark of procedural bitmap generation.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Usage: boiledcorn-pixelbench [ITERATIONS]
+// Compares generating the intro's checkerboard pixel by pixel with FillBitmapPattern.
+// Memory bitmaps are used, so it measures the CPU side only and doesn't need a display.
+
+#include "../pixels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WIDTH 320
+#define HEIGHT 180
+
+static void PutPixels(ALLEGRO_BITMAP* bitmap) {
+	al_set_target_bitmap(bitmap);
+	al_lock_bitmap(bitmap, ALLEGRO_PIXEL_FORMAT_ANY, ALLEGRO_LOCK_WRITEONLY);
+	for (int x = 0; x < WIDTH; x += 2) {
+		for (int y = 0; y < HEIGHT; y += 2) {
+			al_put_pixel(x, y, al_map_rgba(0, 0, 0, 64));
+			al_put_pixel(x + 1, y, al_map_rgba(0, 0, 0, 0));
+			al_put_pixel(x, y + 1, al_map_rgba(0, 0, 0, 0));
+			al_put_pixel(x + 1, y + 1, al_map_rgba(0, 0, 0, 0));
+		}
+	}
+	al_unlock_bitmap(bitmap);
+}
+
+static void FillPattern(ALLEGRO_BITMAP* bitmap) {
+	const uint32_t tile[] = {
+		PackPixel(0, 0, 0, 64), PackPixel(0, 0, 0, 0),
+		PackPixel(0, 0, 0, 0), PackPixel(0, 0, 0, 0)};
+	FillBitmapPattern(bitmap, tile, 2, 2);
+}
+
+static double Measure(void (*func)(ALLEGRO_BITMAP*), ALLEGRO_BITMAP* bitmap, int iterations) {
+	double start = al_get_time();
+	for (int i = 0; i < iterations; i++) {
+		func(bitmap);
+	}
+	return (al_get_time() - start) / iterations;
+}
+
+static bool Compare(ALLEGRO_BITMAP* a, ALLEGRO_BITMAP* b) {
+	ALLEGRO_LOCKED_REGION* ra = al_lock_bitmap(a, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_READONLY);
+	ALLEGRO_LOCKED_REGION* rb = al_lock_bitmap(b, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_READONLY);
+	bool same = true;
+	for (int y = 0; y < HEIGHT && same; y++) {
+		same = memcmp((char*)ra->data + y * ra->pitch, (char*)rb->data + y * rb->pitch, WIDTH * 4) == 0;
+	}
+	al_unlock_bitmap(a);
+	al_unlock_bitmap(b);
+	return same;
+}
+
+int main(int argc, char** argv) {
+	int iterations = (argc > 1) ? atoi(argv[1]) : 1000;
+	if (iterations <= 0) {
+		fprintf(stderr, "Usage: %s [ITERATIONS]\n", argv[0]);
+		return 1;
+	}
+	al_init();
+	al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+	al_set_new_bitmap_format(ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE);
+	ALLEGRO_BITMAP* a = al_create_bitmap(WIDTH, HEIGHT);
+	ALLEGRO_BITMAP* b = al_create_bitmap(WIDTH, HEIGHT);
+
+	double put = Measure(PutPixels, a, iterations);
+	double fill = Measure(FillPattern, b, iterations);
+	printf("al_put_pixel:      %8.3f us\n", put * 1000000);
+	printf("FillBitmapPattern: %8.3f us (%.1fx)\n", fill * 1000000, put / fill);
+
+	bool same = Compare(a, b);
+	if (!same) {
+		fprintf(stderr, "Results differ!\n");
+	}
+	al_destroy_bitmap(a);
+	al_destroy_bitmap(b);
+	return same ? 0 : 1;
+}
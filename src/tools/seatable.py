@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+#
+# Generates sea_thresholds[] for beachsim.c, which lets the sea's wave height be found without floating point.
+#
+# Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# The wave height used to be (int)(fabs(sin(frames / 64.0)) * 16). The phase is kept in units of 2^-60 radians
+# (BEACH_SEA_PHASE_*), so the height is the number of thresholds the phase folded into [0, pi/2] has reached:
+# asin(k / 16) for k from 1 to 15, rounded up, and then the smallest phase for which sin() is close enough to 1
+# to be rounded to exactly 1 in double precision (1 - 2^-54 rounds to even, which is 1).
+#
+# Usage: seatable.py > table.txt, then paste it over the table in beachsim.c.
+# With --check FILE..., compares the table and BEACH_SEA_PHASE_PI in the given files (beachsim.h and beachsim.c)
+# against the generated ones instead.
+
+import math
+import re
+import sys
+from decimal import Decimal, getcontext, ROUND_CEILING, ROUND_FLOOR
+
+DIGITS = 80
+UNIT = Decimal(2) ** 60
+
+
+def pi():
+	# from the decimal module's documentation
+	getcontext().prec += 2
+	three = Decimal(3)
+	lasts, t, s, n, na, d, da = 0, three, 3, 1, 0, 0, 24
+	while s != lasts:
+		lasts = s
+		n, na = n + na, na + 8
+		d, da = d + da, da + 32
+		t = (t * n) / d
+		s += t
+	getcontext().prec -= 2
+	return +s
+
+
+def sin(x):
+	getcontext().prec += 2
+	i, lasts, s, fact, num, sign = 1, 0, x, 1, x, 1
+	while s != lasts:
+		lasts = s
+		i += 2
+		fact *= i * (i - 1)
+		num *= x * x
+		sign *= -1
+		s += num / fact * sign
+	getcontext().prec -= 2
+	return +s
+
+
+def cos(x):
+	getcontext().prec += 2
+	i, lasts, s, fact, num, sign = 0, 0, 1, 1, 1, 1
+	while s != lasts:
+		lasts = s
+		i += 2
+		fact *= i * (i - 1)
+		num *= x * x
+		sign *= -1
+		s += num / fact * sign
+	getcontext().prec -= 2
+	return +s
+
+
+def asin(x):
+	# Newton's method on sin(y) = x, starting from the double precision result
+	y = Decimal(math.asin(float(x)))
+	for _ in range(100):
+		step = (sin(y) - x) / cos(y)
+		y -= step
+		if abs(step) < Decimal(10) ** -(DIGITS - 10):
+			break
+	return y
+
+
+def thresholds():
+	getcontext().prec = DIGITS
+	values = [asin(Decimal(k) / 16) for k in range(1, 16)]
+	values.append(asin(1 - Decimal(2) ** -54))
+	return [int((value * UNIT).to_integral_value(rounding=ROUND_CEILING)) for value in values]
+
+
+def format_table(table):
+	lines = []
+	for i in range(0, len(table), 4):
+		lines.append("\t" + ", ".join("0x%016Xull" % value for value in table[i:i + 4]) + ",")
+	lines[-1] = lines[-1][:-1] + "};"
+	return "\n".join(lines)
+
+
+def main():
+	table = thresholds()
+	getcontext().prec = DIGITS
+	phase_pi = int((pi() * UNIT).to_integral_value(rounding=ROUND_FLOOR))
+
+	if len(sys.argv) >= 3 and sys.argv[1] == "--check":
+		source = ""
+		for path in sys.argv[2:]:
+			with open(path) as f:
+				source += f.read()
+		match = re.search(r"sea_thresholds\[\] = \{(.*?)\};", source, re.S)
+		found = [int(value, 16) for value in re.findall(r"0x([0-9A-Fa-f]+)ull", match.group(1))] if match else []
+		defined = re.search(r"#define BEACH_SEA_PHASE_PI 0x([0-9A-Fa-f]+)ull", source)
+		if found != table:
+			print("sea_thresholds[] doesn't match, it should be:\n" + format_table(table))
+			return 1
+		if defined and int(defined.group(1), 16) != phase_pi:
+			print("BEACH_SEA_PHASE_PI should be 0x%016Xull" % phase_pi)
+			return 1
+		print("sea_thresholds[] matches")
+		return 0
+
+	print("#define BEACH_SEA_PHASE_PI 0x%016Xull" % phase_pi)
+	print("static const uint64_t sea_thresholds[] = {")
+	print(format_table(table))
+	return 0
+
+
+if __name__ == "__main__":
+	sys.exit(main())
@@ -0,0 +1,327 @@
+/*! \file tune.c
+ *  \brief Parameter sweeps over scripted beach sessions.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Usage: boiledcorn-tune [--sessions N] [--threads N] [--seed S] [--people N] [--max-hold N] [SET...]
+// Plays whole sessions of the beach with the scripted player and prints the distribution of their scores
+// for each SET of parameters. A SET is a comma-separated list of overrides of the defaults, such as
+// throw_speed=3,scroll_ticks=6; a value can also be a range like throw_speed=1..4, which expands into
+// a set for each value (and for each combination, when there's more than one range). Every set is played
+// with the same seeds, so differences between them come from the parameters rather than from luck.
+
+#include "../beachsim.h"
+#include <allegro5/allegro.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TUNE_MAX_SETS 4096
+#define TUNE_MAX_THREADS 64
+#define TUNE_MAX_OVERRIDES 8
+#define TUNE_SESSION_TICKS 1000000 // give up on sessions which can't end, e.g. with corns too slow to land
+
+static const struct {
+	const char* name;
+	size_t offset;
+	int min;
+} fields[] = {
+	{"max_power", offsetof(struct BeachParams, max_power), 1},
+	{"throw_speed", offsetof(struct BeachParams, throw_speed), 1},
+	{"scroll_ticks", offsetof(struct BeachParams, scroll_ticks), 1},
+	{"satisfied_chance", offsetof(struct BeachParams, satisfied_chance), 0},
+	{"throws", offsetof(struct BeachParams, throws), 1},
+	{"spawn_x", offsetof(struct BeachParams, spawn_x), 0},
+	{"spawn_width", offsetof(struct BeachParams, spawn_width), 1},
+};
+
+#define FIELD(params, i) (*(int*)((char*)(params) + fields[i].offset))
+
+struct Override {
+	int field;
+	int from, to;
+};
+
+struct Set {
+	struct BeachParams params;
+	char label[128];
+};
+
+struct Tune {
+	struct Set sets[TUNE_MAX_SETS];
+	int nsets;
+	int sessions; // per set
+	uint64_t seed;
+	int people;
+	int max_hold; // 0 to hold up to the set's max_power
+	int* scores; // sessions * nsets, indexed by work item
+};
+
+/*! \brief A thread with the range of work items it's yet to play, which others steal from once they run out of their own. */
+struct Worker {
+	_Alignas(64) atomic_uint_least64_t range; // index of the next item in the upper half, the end in the lower one
+	struct Tune* tune;
+	struct Worker* workers;
+	int index, count;
+	long long ticks;
+	int steals;
+	ALLEGRO_THREAD* thread;
+};
+
+static int PlaySession(struct Tune* tune, const struct BeachParams* params, uint64_t seed, long long* ticks) {
+	struct BeachSim sim;
+	BeachSimInitWithParams(&sim, seed, tune->people, params);
+	struct BeachAutoplayer player;
+	BeachAutoplayerInit(&player, ~seed, tune->max_hold ? tune->max_hold : params->max_power);
+	for (int tick = 0; tick < TUNE_SESSION_TICKS; tick++) {
+		unsigned int input = BeachAutoplay(&player, &sim);
+		if (input & BEACH_INPUT_PRESS) {
+			BeachSimPress(&sim);
+		}
+		if (input & BEACH_INPUT_RELEASE) {
+			BeachSimRelease(&sim);
+		}
+		BeachSimTick(&sim);
+		(*ticks)++;
+		if (!sim.started) {
+			break; // the player starts the session right away, so it's over
+		}
+	}
+	int score = sim.score;
+	BeachSimDestroy(&sim);
+	return score;
+}
+
+static bool Take(struct Worker* worker, uint32_t* item) {
+	uint64_t range = atomic_load(&worker->range);
+	while ((uint32_t)(range >> 32) < (uint32_t)range) {
+		if (atomic_compare_exchange_weak(&worker->range, &range, range + (1ull << 32))) {
+			*item = range >> 32;
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool Steal(struct Worker* worker) {
+	// Take the upper half of what's left to another worker; it keeps taking items from the bottom.
+	for (int i = 1; i < worker->count; i++) {
+		struct Worker* victim = &worker->workers[(worker->index + i) % worker->count];
+		uint64_t range = atomic_load(&victim->range);
+		uint32_t begin, end;
+		while ((begin = range >> 32) < (end = (uint32_t)range)) {
+			uint32_t middle = begin + (end - begin) / 2;
+			if (atomic_compare_exchange_weak(&victim->range, &range, ((uint64_t)begin << 32) | middle)) {
+				atomic_store(&worker->range, ((uint64_t)middle << 32) | end);
+				worker->steals++;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+static void* Work(ALLEGRO_THREAD* thread, void* arg) {
+	struct Worker* worker = arg;
+	struct Tune* tune = worker->tune;
+	uint32_t item;
+	do {
+		while (Take(worker, &item)) {
+			const struct Set* set = &tune->sets[item / tune->sessions];
+			uint64_t seed = tune->seed + item % tune->sessions;
+			tune->scores[item] = PlaySession(tune, &set->params, seed, &worker->ticks);
+		}
+	} while (Steal(worker));
+	return NULL;
+}
+
+static bool ParseOverrides(const char* spec, struct Override* overrides, int* count) {
+	char buf[256];
+	snprintf(buf, sizeof(buf), "%s", spec);
+	*count = 0;
+	for (char* item = strtok(buf, ","); item; item = strtok(NULL, ",")) {
+		char* value = strchr(item, '=');
+		if (!value || (*count == TUNE_MAX_OVERRIDES)) {
+			return false;
+		}
+		*value++ = 0;
+		struct Override* o = &overrides[*count];
+		o->field = -1;
+		for (int i = 0; i < (int)(sizeof(fields) / sizeof(fields[0])); i++) {
+			if (strcmp(fields[i].name, item) == 0) {
+				o->field = i;
+			}
+		}
+		char* range = strstr(value, "..");
+		o->from = atoi(value);
+		o->to = range ? atoi(range + 2) : o->from;
+		if ((o->field == -1) || (o->from < fields[o->field].min) || (o->to < o->from)) {
+			return false;
+		}
+		(*count)++;
+	}
+	return true;
+}
+
+static bool Expand(struct Tune* tune, const struct Override* overrides, int count, int n, struct BeachParams params, const char* label) {
+	if (n == count) {
+		if (tune->nsets == TUNE_MAX_SETS) {
+			return false;
+		}
+		struct Set* set = &tune->sets[tune->nsets++];
+		set->params = params;
+		snprintf(set->label, sizeof(set->label), "%s", count ? label : "defaults");
+		return true;
+	}
+	for (int value = overrides[n].from; value <= overrides[n].to; value++) {
+		char next[128];
+		snprintf(next, sizeof(next), "%s%s%s=%d", label, n ? "," : "", fields[overrides[n].field].name, value);
+		FIELD(&params, overrides[n].field) = value;
+		if (!Expand(tune, overrides, count, n + 1, params, next)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static int CompareInts(const void* a, const void* b) {
+	int x = *(const int*)a, y = *(const int*)b;
+	return (x > y) - (x < y);
+}
+
+static void Report(struct Tune* tune, const struct Set* set, int* scores) {
+	qsort(scores, tune->sessions, sizeof(int), CompareInts);
+	double sum = 0, squares = 0;
+	for (int i = 0; i < tune->sessions; i++) {
+		sum += scores[i];
+		squares += (double)scores[i] * scores[i];
+	}
+	double mean = sum / tune->sessions;
+	double variance = squares / tune->sessions - mean * mean;
+	// score is hits minus misses, and every corn is one or the other
+	double hits = (mean + set->params.throws) / 2 / set->params.throws;
+	printf("%-40s %7.2f %6.2f %5.1f%% %4d %4d %4d %4d %4d\n", set->label, mean, (variance > 0) ? sqrt(variance) : 0, hits * 100,
+		scores[0], scores[tune->sessions / 10], scores[tune->sessions / 2], scores[tune->sessions * 9 / 10], scores[tune->sessions - 1]);
+}
+
+int main(int argc, char** argv) {
+	static struct Tune tune = {.sessions = 1000, .seed = 1, .people = BEACH_PEOPLE};
+	static struct Worker workers[TUNE_MAX_THREADS];
+	al_init();
+	int threads = al_get_cpu_count();
+
+	int first = argc;
+	for (int i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "--sessions") == 0) && (i + 1 < argc)) {
+			tune.sessions = atoi(argv[++i]);
+		} else if ((strcmp(argv[i], "--threads") == 0) && (i + 1 < argc)) {
+			threads = atoi(argv[++i]);
+		} else if ((strcmp(argv[i], "--seed") == 0) && (i + 1 < argc)) {
+			tune.seed = strtoull(argv[++i], NULL, 10);
+		} else if ((strcmp(argv[i], "--people") == 0) && (i + 1 < argc)) {
+			tune.people = atoi(argv[++i]);
+		} else if ((strcmp(argv[i], "--max-hold") == 0) && (i + 1 < argc)) {
+			tune.max_hold = atoi(argv[++i]);
+		} else {
+			first = i;
+			break;
+		}
+	}
+	for (int i = first; i < argc; i++) {
+		struct Override overrides[TUNE_MAX_OVERRIDES];
+		int count;
+		if (!ParseOverrides(argv[i], overrides, &count)) {
+			fprintf(stderr, "Invalid parameter set %s\n", argv[i]);
+			first = -1;
+			break;
+		}
+		if (!Expand(&tune, overrides, count, 0, BeachDefaultParams, "")) {
+			fprintf(stderr, "Too many parameter sets, up to %d can be played at once\n", TUNE_MAX_SETS);
+			first = -1;
+			break;
+		}
+	}
+	if ((first == -1) || (tune.sessions <= 0) || (tune.max_hold < 0)) {
+		fprintf(stderr, "Usage: %s [--sessions N] [--threads N] [--seed S] [--people N] [--max-hold N] [SET...]\n", argv[0]);
+		fprintf(stderr, "Parameters:");
+		for (int i = 0; i < (int)(sizeof(fields) / sizeof(fields[0])); i++) {
+			fprintf(stderr, " %s=%d", fields[i].name, FIELD(&BeachDefaultParams, i));
+		}
+		fprintf(stderr, "\n");
+		return 1;
+	}
+	if (!tune.nsets) {
+		Expand(&tune, NULL, 0, 0, BeachDefaultParams, "");
+	}
+	if ((long long)tune.sessions * tune.nsets > UINT32_MAX) {
+		fprintf(stderr, "Too many sessions\n");
+		return 1;
+	}
+	if (threads < 1) {
+		threads = 1;
+	}
+	if (threads > TUNE_MAX_THREADS) {
+		threads = TUNE_MAX_THREADS;
+	}
+
+	uint32_t items = tune.sessions * tune.nsets;
+	tune.scores = malloc(items * sizeof(int));
+	double start = al_get_time();
+	for (int i = 0; i < threads; i++) {
+		uint64_t begin = (uint64_t)items * i / threads, end = (uint64_t)items * (i + 1) / threads;
+		atomic_init(&workers[i].range, (begin << 32) | end);
+		workers[i].tune = &tune;
+		workers[i].workers = workers;
+		workers[i].index = i;
+		workers[i].count = threads;
+	}
+	for (int i = 0; i < threads; i++) {
+		workers[i].thread = al_create_thread(Work, &workers[i]);
+		if (workers[i].thread) {
+			al_start_thread(workers[i].thread);
+		}
+	}
+	long long ticks = 0;
+	int steals = 0;
+	for (int i = 0; i < threads; i++) {
+		if (!workers[i].thread) {
+			Work(NULL, &workers[i]); // whatever wasn't stolen gets played here
+			continue;
+		}
+		al_join_thread(workers[i].thread, NULL);
+		al_destroy_thread(workers[i].thread);
+	}
+	for (int i = 0; i < threads; i++) {
+		ticks += workers[i].ticks;
+		steals += workers[i].steals;
+	}
+	double elapsed = al_get_time() - start;
+
+	printf("%-40s %7s %6s %6s %4s %4s %4s %4s %4s\n", "set", "mean", "stddev", "hits", "min", "p10", "p50", "p90", "max");
+	for (int i = 0; i < tune.nsets; i++) {
+		Report(&tune, &tune.sets[i], tune.scores + (size_t)i * tune.sessions);
+	}
+	printf("%u sessions on %d threads in %.3f s: %.0f sessions/s, %.0f ticks/s, %d ranges stolen\n",
+		items, threads, elapsed, items / elapsed, ticks / elapsed, steals);
+
+	free(tune.scores);
+	return 0;
+}
@@ -0,0 +1,66 @@
+/*! \file upscale.c
+ *  \brief Drawing at the native resolution and scaling up to the window in one pass.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "upscale.h"
+
+ALLEGRO_BITMAP* CreateLowResTarget(int width, int height) {
+	// sampled with nearest neighbour, so that whole multiples keep pixels sharp
+	ALLEGRO_STATE state;
+	al_store_state(&state, ALLEGRO_STATE_NEW_BITMAP_PARAMETERS);
+	al_set_new_bitmap_flags(al_get_new_bitmap_flags() & ~(ALLEGRO_MAG_LINEAR | ALLEGRO_MIN_LINEAR));
+	ALLEGRO_BITMAP* bitmap = CreateNotPreservedBitmap(width, height);
+	al_restore_state(&state);
+	return bitmap;
+}
+
+int GetUpscaleDetail(struct Game* game, int width, int height) {
+	// The largest divisor of the framebuffer's whole scale factor up to UPSCALE_MAX_DETAIL. A target that
+	// many times larger than the native resolution still gets upscaled from by whole factors.
+	int factor = (game->clip_rect.w / width < game->clip_rect.h / height) ? game->clip_rect.w / width : game->clip_rect.h / height;
+	for (int detail = UPSCALE_MAX_DETAIL; detail > 1; detail--) {
+		if ((factor >= detail) && (factor % detail == 0)) {
+			return detail;
+		}
+	}
+	return 1;
+}
+
+void DrawUpscaled(struct Game* game, ALLEGRO_BITMAP* bitmap) {
+	// Draws onto the current target (usually the framebuffer) in its pixels rather than viewport units,
+	// scaled by the largest whole factor that fits and centered within the clipping rectangle.
+	int width = al_get_bitmap_width(bitmap), height = al_get_bitmap_height(bitmap);
+	int cx, cy, cw, ch;
+	al_get_clipping_rectangle(&cx, &cy, &cw, &ch);
+
+	float scale = (cw / width < ch / height) ? cw / width : ch / height;
+	if (scale < 1) {
+		// smaller than the native resolution, nothing sharp can be done about it
+		scale = ((float)cw / width < (float)ch / height) ? (float)cw / width : (float)ch / height;
+	}
+	int x = cx + (int)((cw - width * scale) / 2), y = cy + (int)((ch - height * scale) / 2);
+
+	ALLEGRO_TRANSFORM transform, identity;
+	al_copy_transform(&transform, al_get_current_transform());
+	al_identity_transform(&identity);
+	al_use_transform(&identity);
+	al_clear_to_color(al_map_rgb(0, 0, 0));
+	al_draw_scaled_bitmap(bitmap, 0, 0, width, height, x, y, width * scale, height * scale, 0);
+	al_use_transform(&transform);
+}
@@ -0,0 +1,33 @@
+/*! \file upscale.h
+ *  \brief Drawing at the native resolution and scaling up to the window in one pass.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UPSCALE_H
+#define UPSCALE_H
+
+#include "common.h"
+
+// Most a low-resolution target may be enlarged by to show movement finer than its pixels, which bounds the fill rate.
+#define UPSCALE_MAX_DETAIL 4
+
+ALLEGRO_BITMAP* CreateLowResTarget(int width, int height);
+int GetUpscaleDetail(struct Game* game, int width, int height);
+void DrawUpscaled(struct Game* game, ALLEGRO_BITMAP* bitmap);
+
+#endif
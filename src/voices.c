@@ -0,0 +1,110 @@
+/*! \file voices.c
+ *  \brief Streamed playback of longer sound clips.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "voices.h"
+#include "loader.h"
+
+void InitVoicePool(struct VoicePool* pool, struct Game* game, int voices, size_t buffers, unsigned int samples) {
+	memset(pool, 0, sizeof(struct VoicePool));
+	pool->game = game;
+	pool->nvoices = voices;
+	pool->buffers = buffers;
+	pool->samples = samples;
+}
+
+static void ReportClipMemory(struct VoicePool* pool, struct VoiceClip* clip) {
+	ALLEGRO_AUDIO_STREAM* stream = clip->stream;
+	size_t frame = al_get_channel_count(al_get_audio_stream_channels(stream)) * al_get_audio_depth_size(al_get_audio_stream_depth(stream));
+	size_t decoded = (size_t)(al_get_audio_stream_length_secs(stream) * al_get_audio_stream_frequency(stream)) * frame;
+	size_t buffers = pool->buffers * pool->samples * frame;
+	PrintConsole(pool->game, "%s: streamed, %zu KiB of buffers instead of %zu KiB decoded", clip->name, buffers / 1024, decoded / 1024);
+}
+
+int AddVoiceClip(struct VoicePool* pool, const char* name, ALLEGRO_MIXER* mixer) {
+	if (pool->nclips == VOICE_POOL_MAX_CLIPS) {
+		return -1;
+	}
+	int id = pool->nclips++;
+	struct VoiceClip* clip = &pool->clips[id];
+	clip->name = name;
+	clip->mixer = mixer;
+	clip->stream = LoadAudioStream(pool->game, name, pool->buffers, pool->samples);
+	if (clip->stream) {
+		al_set_audio_stream_playing(clip->stream, false);
+		al_set_audio_stream_playmode(clip->stream, ALLEGRO_PLAYMODE_ONCE);
+		al_attach_audio_stream_to_mixer(clip->stream, mixer);
+		ReportClipMemory(pool, clip);
+	}
+	return id;
+}
+
+void PlayVoiceClip(struct VoicePool* pool, int id) {
+	if (id < 0 || id >= pool->nclips || !pool->nvoices || !pool->clips[id].stream) {
+		return;
+	}
+	struct VoiceClip* clip = &pool->clips[id];
+
+	// make room by stopping the clips that started first
+	for (;;) {
+		struct VoiceClip* oldest = NULL;
+		int playing = 0;
+		for (int i = 0; i < pool->nclips; i++) {
+			struct VoiceClip* other = &pool->clips[i];
+			if (other != clip && other->stream && al_get_audio_stream_playing(other->stream)) {
+				playing++;
+				if (!oldest || other->started < oldest->started) {
+					oldest = other;
+				}
+			}
+		}
+		if (playing < pool->nvoices) {
+			break;
+		}
+		al_set_audio_stream_playing(oldest->stream, false);
+	}
+
+	al_rewind_audio_stream(clip->stream);
+	al_set_audio_stream_playing(clip->stream, true);
+	clip->started = ++pool->clock;
+}
+
+void StopVoiceClip(struct VoicePool* pool, int id) {
+	if (id >= 0 && id < pool->nclips && pool->clips[id].stream) {
+		al_set_audio_stream_playing(pool->clips[id].stream, false);
+	}
+}
+
+void DestroyVoicePool(struct VoicePool* pool) {
+	for (int i = 0; i < pool->nclips; i++) {
+		if (pool->clips[i].stream) {
+			al_destroy_audio_stream(pool->clips[i].stream);
+		}
+		pool->clips[i].stream = NULL;
+	}
+	pool->nclips = 0;
+}
+
+void ReportSampleMemory(struct Game* game, const char* name, ALLEGRO_SAMPLE* sample) {
+	if (!sample) {
+		return;
+	}
+	size_t size = (size_t)al_get_sample_length(sample) * al_get_channel_count(al_get_sample_channels(sample)) * al_get_audio_depth_size(al_get_sample_depth(sample));
+	PrintConsole(game, "%s: resident, %zu KiB decoded", name, size / 1024);
+}
@@ -0,0 +1,63 @@
+/*! \file voices.h
+ *  \brief Streamed playback of longer sound clips.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VOICES_H
+#define VOICES_H
+
+#include "common.h"
+
+#define VOICE_POOL_MAX_CLIPS 8
+
+// ~35ms of latency at 44.1kHz, which is still fine for sound effects.
+#define VOICE_BUFFERS 3
+#define VOICE_BUFFER_SAMPLES 512
+
+struct VoiceClip {
+	const char* name;
+	ALLEGRO_MIXER* mixer;
+	ALLEGRO_AUDIO_STREAM* stream; /*!< NULL if the clip couldn't be opened. */
+	unsigned int started;
+};
+
+/*! \brief Plays clips through audio streams instead of keeping them decoded in memory.
+ *
+ * Every clip gets its own stream when it's added, so playing it only rewinds it and nothing gets opened
+ * or allocated mid-game. At most `voices` clips play at once; starting another one stops the one that
+ * has been playing the longest.
+ */
+struct VoicePool {
+	struct Game* game;
+	struct VoiceClip clips[VOICE_POOL_MAX_CLIPS];
+	int nclips;
+	int nvoices;
+	size_t buffers;
+	unsigned int samples;
+	unsigned int clock;
+};
+
+void InitVoicePool(struct VoicePool* pool, struct Game* game, int voices, size_t buffers, unsigned int samples);
+int AddVoiceClip(struct VoicePool* pool, const char* name, ALLEGRO_MIXER* mixer);
+void PlayVoiceClip(struct VoicePool* pool, int clip);
+void StopVoiceClip(struct VoicePool* pool, int clip);
+void DestroyVoicePool(struct VoicePool* pool);
+
+void ReportSampleMemory(struct Game* game, const char* name, ALLEGRO_SAMPLE* sample);
+
+#endif